@@ -0,0 +1,316 @@
+#include "batch.h"
+#include "puzzleio.h"
+#include "threadpool.h"
+#include "verify.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+/* =========================================== */
+/* =============== BATCH SOLVE =============== */
+/* =========================================== */
+
+const char* statusNames[BatchSolver::numStatus] = {"solved", "unique", "multiple", "unsolvable", "gave-up", "invalid"};
+
+BatchSolver::BatchSolver(const BatchOptions& options)
+    : _options(options), _solver(options.solver), _puzzle(nullptr), _values(Sudoku::maxSize * Sudoku::maxSize) {
+    _solver.stats = &_stats;
+}
+
+BatchSolver::~BatchSolver() { delete _puzzle; }
+
+size_t BatchSolver::maxOutput(size_t length) {
+    return length + 1 + std::max<size_t>(maxSolutionLength(length), 4) + 32; // puzzle, solution or none, count, status
+}
+
+size_t BatchSolver::solveLine(const char* line, size_t length, char* out, Status& status) {
+    int found = 0;
+    int size = parsePuzzle(line, length, _values.data());
+    if (size == 0) status = invalid;
+    else {
+        if (!_puzzle || _puzzle->getSize() != size) {
+            delete _puzzle;
+            _puzzle = new Sudoku(size, _values.data());
+        }
+        else _puzzle->load(_values.data());
+
+        if (_puzzle->hasConflicts()) status = invalid;
+        else {
+            int limit = std::max(_options.countLimit, _options.status ? 2 : 1);
+            found = _options.cache ? _options.cache->countSolutions(*_puzzle, limit, _solver)
+                                   : SudokuSolver::countSolutions(*_puzzle, limit, _solver);
+            if (found == SudokuSolver::gaveUp) status = gaveUp;
+            else if (found == 0) status = unsolvable;
+            else if (limit == 1) status = solved;
+            else status = (found == 1) ? unique : multiple;
+        }
+    }
+
+    char* start = out;
+    if (!_options.solutionOnly) {
+        std::memcpy(out, line, length);
+        out += length;
+        *out++ = ' ';
+    }
+    if (found > 0) out += formatPuzzle(*_puzzle, out); // board holds the first solution
+    else { std::memcpy(out, "none", 4); out += 4; }
+
+    if (_options.countLimit > 0) out += std::sprintf(out, " %d", std::max(found, 0));
+    if (_options.status) out += std::sprintf(out, " %s", statusNames[status]);
+    *out++ = '\n';
+    return out - start;
+}
+
+/* ============== PARALLEL BATCH ============= */
+
+/* Lines handed to a worker at once, with their output */
+struct BatchChunk {
+    std::vector<char> input;        // lines, each followed by a newline
+    std::vector<char> output;
+    long numPuzzles;
+    long statusCount[BatchSolver::numStatus];
+    bool done;
+};
+
+static const int chunkLines = 256;
+
+static void solveChunk(BatchChunk& chunk, BatchSolver& solver) {
+    size_t used = 0, pos = 0;
+    chunk.numPuzzles = 0;
+    std::fill(chunk.statusCount, chunk.statusCount + BatchSolver::numStatus, 0);
+    while (pos < chunk.input.size()) {
+        const char* line = chunk.input.data() + pos;
+        size_t length = static_cast<const char*>(std::memchr(line, '\n', chunk.input.size() - pos)) - line;
+        pos += length + 1;
+
+        BatchSolver::Status status;
+        chunk.output.resize(used + BatchSolver::maxOutput(length));
+        used += solver.solveLine(line, length, chunk.output.data() + used, status);
+        chunk.statusCount[status]++;
+        chunk.numPuzzles++;
+    }
+    chunk.output.resize(used);
+}
+
+/* Reads chunks of lines, solves them on a thread pool and writes the results in input order.
+   Each worker keeps its own BatchSolver, and at most a few chunks per worker are in flight */
+static void solveParallel(const BatchOptions& options, LineReader& reader, BufferedWriter& writer,
+                          long& numPuzzles, long* statusCount, SudokuSolver::SolverStats& stats) {
+    ThreadPool pool(options.threads);
+    std::vector<std::unique_ptr<BatchSolver>> solvers;
+    for (int w = 0; w < pool.size(); w++) solvers.emplace_back(new BatchSolver(options));
+
+    std::mutex doneMutex;
+    std::condition_variable chunkDone;
+    std::deque<std::unique_ptr<BatchChunk>> inFlight;   // in input order
+    std::vector<std::unique_ptr<BatchChunk>> spare;
+    size_t maxInFlight = 4 * pool.size();
+
+    auto writeOldest = [&]() {
+        BatchChunk& chunk = *inFlight.front();
+        {
+            std::unique_lock<std::mutex> lock(doneMutex);
+            chunkDone.wait(lock, [&] { return chunk.done; });
+        }
+        writer.write(chunk.output.data(), chunk.output.size());
+        numPuzzles += chunk.numPuzzles;
+        for (int s = 0; s < BatchSolver::numStatus; s++) statusCount[s] += chunk.statusCount[s];
+        spare.push_back(std::move(inFlight.front()));
+        inFlight.pop_front();
+    };
+
+    const char* line;
+    size_t length;
+    bool more = true;
+    while (more) {
+        std::unique_ptr<BatchChunk> chunk;
+        if (spare.empty()) chunk.reset(new BatchChunk());
+        else { chunk = std::move(spare.back()); spare.pop_back(); }
+        chunk->input.clear();
+        chunk->done = false;
+
+        int numLines = 0;
+        while (numLines < chunkLines && (more = reader.next(line, length))) {
+            if (length == 0 || line[0] == '#') continue; // blank lines and comments
+            chunk->input.insert(chunk->input.end(), line, line + length);
+            chunk->input.push_back('\n');
+            numLines++;
+        }
+        if (numLines == 0) break;
+
+        BatchChunk* task = chunk.get();
+        inFlight.push_back(std::move(chunk));
+        pool.submit([&, task](int worker) {
+            solveChunk(*task, *solvers[worker]);
+            std::lock_guard<std::mutex> lock(doneMutex);
+            task->done = true;
+            chunkDone.notify_all();
+        });
+        if (inFlight.size() >= maxInFlight) writeOldest();
+    }
+    while (!inFlight.empty()) writeOldest();
+    for (auto& solver : solvers) stats += solver->stats();
+}
+
+/* =============== BATCH VERIFY ============== */
+
+static const size_t verifyBlock = 1024; // boards checked by one verifySolutions call
+
+/* Reads "<puzzle> <solution> ..." or a lone solution, returns the board size or 0 if the line
+   has no solution. Without a puzzle, puzzle is left empty */
+static int parseSolvedLine(const char* line, size_t length, Sudoku::Value* puzzle, Sudoku::Value* grid) {
+    const char* end = line + length;
+    const char* split = std::find_if(line, end, [](char c) { return c == ' ' || c == '\t'; });
+    const char* second = std::find_if(split, end, [](char c) { return c != ' ' && c != '\t'; });
+    const char* secondEnd = std::find_if(second, end, [](char c) { return c == ' ' || c == '\t'; });
+
+    int size = (second < end) ? parsePuzzle(second, secondEnd - second, grid) : 0;
+    if (size > 0) return (parsePuzzle(line, split - line, puzzle) == size) ? size : 0;
+    if (second < end && std::string(second, secondEnd) == "none") return 0;
+
+    size = parsePuzzle(line, split - line, grid); // solution only, maybe followed by a count and status
+    std::fill(puzzle, puzzle + size*size, 0);
+    return size;
+}
+
+/* Checks solved lines in blocks of boards of one size, prints the numbers of the lines that failed */
+static void verifyLines(LineReader& reader, BufferedWriter& writer, long& numBoards, long& numFailed) {
+    std::vector<Sudoku::Value> puzzles, grids, values(2 * Sudoku::maxSize * Sudoku::maxSize);
+    std::vector<long> lineNumbers;
+    bool ok[verifyBlock];
+    int blockSize = 0;
+
+    auto checkBlock = [&]() {
+        size_t count = lineNumbers.size();
+        numFailed += verifySolutions(blockSize, puzzles.data(), grids.data(), count, ok);
+        for (size_t k = 0; k < count; k++)
+            if (!ok[k]) writer.commit(std::sprintf(writer.reserve(24), "%ld\n", lineNumbers[k]));
+        numBoards += count;
+        puzzles.clear();
+        grids.clear();
+        lineNumbers.clear();
+    };
+
+    const char* line;
+    size_t length;
+    long lineNumber = 0;
+    while (reader.next(line, length)) {
+        lineNumber++;
+        if (length == 0 || line[0] == '#') continue; // blank lines and comments
+        Sudoku::Value* puzzle = values.data();
+        Sudoku::Value* grid = puzzle + Sudoku::maxSize * Sudoku::maxSize;
+        int size = parseSolvedLine(line, length, puzzle, grid);
+        if (size == 0) { // nothing to check
+            writer.commit(std::sprintf(writer.reserve(24), "%ld\n", lineNumber));
+            numBoards++;
+            numFailed++;
+            continue;
+        }
+        if (size != blockSize || lineNumbers.size() == verifyBlock) {
+            if (!lineNumbers.empty()) checkBlock();
+            blockSize = size;
+        }
+        puzzles.insert(puzzles.end(), puzzle, puzzle + size*size);
+        grids.insert(grids.end(), grid, grid + size*size);
+        lineNumbers.push_back(lineNumber);
+    }
+    if (!lineNumbers.empty()) checkBlock();
+}
+
+/* ================ COMMAND ================== */
+
+static int batchUsage() {
+    std::cerr << "usage: sudoku --batch [--solution-only] [--count[=N]] [--status] [--dlx] [--threads[=N]] [--cache[=N]]\n"
+                 "                     [--budget=N] [--stats] [file]\n"
+                 "       sudoku --batch --verify [file]\n";
+    return 2;
+}
+
+int runBatch(int argc, char* argv[]) {
+    BatchOptions options;
+    size_t cacheCapacity = 0;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--solution-only") options.solutionOnly = true;
+        else if (arg == "--count") options.countLimit = 2;
+        else if (arg.rfind("--count=", 0) == 0) options.countLimit = std::max(1, std::atoi(arg.c_str() + 8));
+        else if (arg == "--status") options.status = true;
+        else if (arg == "--dlx") options.solver.engine = SudokuSolver::Engine::dancingLinks;
+        else if (arg == "--threads") options.threads = 0;
+        else if (arg.rfind("--threads=", 0) == 0) options.threads = std::max(0, std::atoi(arg.c_str() + 10));
+        else if (arg == "--verify") options.verify = true;
+        else if (arg.rfind("--budget=", 0) == 0) options.solver.nodeBudget = std::max(0L, std::atol(arg.c_str() + 9));
+        else if (arg == "--stats") options.stats = true;
+        else if (arg == "--cache") cacheCapacity = 1 << 16;
+        else if (arg.rfind("--cache=", 0) == 0) cacheCapacity = std::max(1, std::atoi(arg.c_str() + 8));
+        else if (arg.size() > 1 && arg[0] == '-' && arg != "-") return batchUsage();
+        else if (!options.input) options.input = argv[i];
+        else return batchUsage();
+    }
+
+    std::chrono::steady_clock sc;
+    auto start = sc.now();
+    if (options.verify) {
+        long numBoards = 0, numFailed = 0;
+        try {
+            LineReader reader(options.input);
+            BufferedWriter writer(1);
+            verifyLines(reader, writer, numBoards, numFailed);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "sudoku: " << e.what() << "\n";
+            return 1;
+        }
+        double seconds = static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+        std::cerr << numBoards << " boards verified in " << seconds << " s (" << (seconds > 0 ? numBoards / seconds : 0)
+                  << " boards/s, " << verifyKernel(9) << " kernel for 9x9): " << numFailed << " failed\n";
+        return numFailed ? 1 : 0;
+    }
+
+    std::unique_ptr<ResultCache> cache(cacheCapacity ? new ResultCache(cacheCapacity) : nullptr);
+    options.cache = cache.get();
+    long numPuzzles = 0, statusCount[BatchSolver::numStatus] = {0};
+    SudokuSolver::SolverStats stats;
+    try {
+        LineReader reader(options.input);
+        BufferedWriter writer(1);
+        if (options.threads != 1) solveParallel(options, reader, writer, numPuzzles, statusCount, stats);
+        BatchSolver solver(options);
+        const char* line;
+        size_t length;
+        while (options.threads == 1 && reader.next(line, length)) {
+            if (length == 0 || line[0] == '#') continue; // blank lines and comments
+            BatchSolver::Status status;
+            char* out = writer.reserve(BatchSolver::maxOutput(length));
+            writer.commit(solver.solveLine(line, length, out, status));
+            statusCount[status]++;
+            numPuzzles++;
+        }
+        stats += solver.stats();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "sudoku: " << e.what() << "\n";
+        return 1;
+    }
+
+    double seconds = static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+    std::cerr << numPuzzles << " puzzles in " << seconds << " s (" << (seconds > 0 ? numPuzzles / seconds : 0) << " puzzles/s):";
+    for (int s = 0; s < BatchSolver::numStatus; s++)
+        if (statusCount[s]) std::cerr << " " << statusCount[s] << " " << statusNames[s];
+    if (cache) {
+        ResultCache::Stats cacheStats = cache->stats();
+        std::cerr << "; cache " << cacheStats.hits << " hits of " << cacheStats.lookups << " ("
+                  << (cacheStats.lookups ? 100.0 * cacheStats.hits / cacheStats.lookups : 0) << "%), " << cacheStats.uncacheable
+                  << " uncacheable, " << (cacheStats.lookups ? 1e6 * cacheStats.canonicalSeconds / cacheStats.lookups : 0)
+                  << " us per canonical form";
+    }
+    std::cerr << "\n";
+    if (options.stats)
+        std::cerr << stats.searches << " searches: " << stats.nodes << " nodes (" << (numPuzzles ? stats.nodes / numPuzzles : 0)
+                  << " per puzzle), " << stats.backtracks << " backtracks, max depth " << stats.maxDepth << ", "
+                  << stats.candidatesTried << " candidates tried, " << stats.outOfBudget << " out of budget, "
+                  << stats.searchSeconds << " s searching\n";
+    return 0;
+}
@@ -0,0 +1,64 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <cstddef>
+#include <vector>
+
+#include "sudoku.h"
+#include "canonical.h"
+
+/* =========================================== */
+/* =============== BATCH SOLVE =============== */
+/* =========================================== */
+
+/* Solves puzzle lines (see puzzleio.h) from a file or stdin, one output line per puzzle:
+   "<puzzle> <solution>", or only "<solution>", then optionally the solution count and a status.
+   Unsolvable or invalid puzzles, and those whose search ran out of its node budget, get "none" as their solution */
+
+struct BatchOptions {
+    const char* input = nullptr;    // file to read, nullptr or "-" for stdin
+    bool solutionOnly = false;      // leave the puzzle out of the output
+    int countLimit = 0;             // print solution counts up to this limit, 0 for none
+    bool status = false;            // print the status (see BatchSolver::Status)
+    int threads = 1;                // worker threads, 0 for one per core
+    bool verify = false;            // check solved lines instead of solving (see runBatch)
+    ResultCache* cache = nullptr;   // answers boards of already solved symmetry classes, shared by the workers
+    bool stats = false;             // print the search counters of the whole batch (see SudokuSolver::SolverStats)
+    SudokuSolver::Options solver;
+};
+
+/* Solves lines one by one, reusing its board and buffers between puzzles */
+class BatchSolver {
+public:
+    enum Status { solved, unique, multiple, unsolvable, gaveUp, invalid, numStatus }; // solved: uniqueness not checked
+
+private:
+    const BatchOptions& _options;
+    SudokuSolver::Options _solver;          // the options' solver options, counting into _stats
+    SudokuSolver::SolverStats _stats;
+    Sudoku* _puzzle;                        // reused while the board size does not change
+    std::vector<Sudoku::Value> _values;
+
+public:
+    explicit BatchSolver(const BatchOptions& options);
+
+    ~BatchSolver();
+
+    /* Longest output solveLine can write for an input line */
+    static size_t maxOutput(size_t length);
+
+    /* Solves one line and writes its output line (with newline) to out, returns the number of characters */
+    size_t solveLine(const char* line, size_t length, char* out, Status& status);
+
+    /* Of all the lines solved so far */
+    const SudokuSolver::SolverStats& stats() const { return _stats; }
+};
+
+extern const char* statusNames[BatchSolver::numStatus];
+
+/* Entry point of "sudoku --batch [options] [file]", returns the process exit code.
+   With --verify the lines are "<puzzle> <solution> ..." as written above, or a lone solution,
+   and the numbers of the lines whose solution is wrong are printed. Exits with 1 if any is */
+int runBatch(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,202 @@
+#include "sudoku.h"
+#include "verify.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+/* =========================================== */
+/* ================ BENCHMARK ================ */
+/* =========================================== */
+
+/* sudoku_bench [--seed=N] [--count=N] [--output=file]
+   Generates a fixed-seed corpus for every board size and difficulty, then times generation, solving,
+   uniqueness checks and verification separately with every engine. Engines must agree on every puzzle.
+   Progress goes to stderr, the results to stdout (or the output file) as JSON */
+
+struct BenchEngine {
+    const char* name;
+    SudokuSolver::Options options;
+    int maxSize;                    // larger boards are too slow for this engine
+};
+
+/* Durations of one phase, in microseconds */
+struct Timings {
+    std::vector<double> samples;
+
+    double mean() const {
+        double sum = 0;
+        for (double s : samples) sum += s;
+        return samples.empty() ? 0 : sum / samples.size();
+    }
+
+    double percentile(double q) {
+        if (samples.empty()) return 0;
+        std::sort(samples.begin(), samples.end());
+        size_t rank = (size_t) std::ceil(q * samples.size());
+        return samples[std::min(samples.size() - 1, rank ? rank - 1 : 0)];
+    }
+};
+
+struct Corpus {
+    int size, difficulty;
+    std::vector<Sudoku*> puzzles, solutions;    // solutions of the first engine
+    Timings generate, verify;
+    double verifyBatch;                         // per board, all boards in one verifySolutions call
+    std::vector<Timings> solve, unique;         // per engine
+    std::vector<long> disagreements;            // per engine
+};
+
+static std::chrono::steady_clock sc;
+
+static double microseconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::micro>(sc.now() - start).count();
+}
+
+static void writeTimings(FILE* out, const char* name, Timings& timings) {
+    std::fprintf(out, "\"%s\": {\"mean_us\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f}",
+                 name, timings.mean(), timings.percentile(0.5), timings.percentile(0.99), timings.percentile(1));
+}
+
+static void runCorpus(Corpus& corpus, int count, uint64_t seed, const std::vector<BenchEngine>& engines) {
+    // generate, each puzzle from its own seed
+    for (int k = 0; k < count; k++) {
+        Random random(seed + k);
+        auto start = sc.now();
+        corpus.puzzles.push_back(new Sudoku(corpus.difficulty, corpus.size, random));
+        corpus.generate.samples.push_back(microseconds(start));
+    }
+
+    // solve and check uniqueness with every engine, comparing against the first one
+    corpus.solve.resize(engines.size());
+    corpus.unique.resize(engines.size());
+    corpus.disagreements.assign(engines.size(), 0);
+    for (size_t e = 0; e < engines.size(); e++) {
+        if (corpus.size > engines[e].maxSize) continue;
+        for (int k = 0; k < count; k++) {
+            Sudoku* solution = new Sudoku(*corpus.puzzles[k]);
+            auto start = sc.now();
+            bool solved = SudokuSolver::solve(*solution, engines[e].options);
+            corpus.solve[e].samples.push_back(microseconds(start));
+
+            start = sc.now();
+            bool unique = SudokuSolver::isUnique(*corpus.puzzles[k], engines[e].options);
+            corpus.unique[e].samples.push_back(microseconds(start));
+
+            if (e == 0) corpus.solutions.push_back(solution);
+            else {
+                bool same = true;
+                for (int i = 0; i < solution->getNumCells(); i++) same = same && solution->valueAt(i) == corpus.solutions[k]->valueAt(i);
+                if (!same) corpus.disagreements[e]++;
+                delete solution;
+            }
+            if (!solved || !unique) corpus.disagreements[e]++; // generated puzzles have one solution
+        }
+    }
+
+    // verify, one board at a time and all at once
+    int numCells = corpus.size * corpus.size;
+    std::vector<Sudoku::Value> clues(count * numCells), grids(count * numCells);
+    for (int k = 0; k < count; k++) {
+        auto start = sc.now();
+        if (!SudokuSolver::isSolution(*corpus.puzzles[k], *corpus.solutions[k])) corpus.disagreements[0]++;
+        corpus.verify.samples.push_back(microseconds(start));
+        for (int i = 0; i < numCells; i++) {
+            clues[k * numCells + i] = corpus.puzzles[k]->isDraftAt(i) ? 0 : corpus.puzzles[k]->valueAt(i);
+            grids[k * numCells + i] = corpus.solutions[k]->valueAt(i);
+        }
+    }
+    std::unique_ptr<bool[]> ok(new bool[count]);
+    auto start = sc.now();
+    size_t failed = verifySolutions(corpus.size, clues.data(), grids.data(), count, ok.get());
+    corpus.verifyBatch = microseconds(start) / count;
+    corpus.disagreements[0] += failed;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned seed = 1;
+    int count = 200;
+    const char* output = nullptr;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--seed=", 0) == 0) seed = std::strtoul(arg.c_str() + 7, nullptr, 10);
+        else if (arg.rfind("--count=", 0) == 0) count = std::max(1, std::atoi(arg.c_str() + 8));
+        else if (arg.rfind("--output=", 0) == 0) output = argv[i] + 9;
+        else {
+            std::cerr << "usage: sudoku_bench [--seed=N] [--count=N] [--output=file]\n";
+            return 2;
+        }
+    }
+
+    std::vector<BenchEngine> engines(4);
+    engines[0] = {"backtracking", SudokuSolver::Options(), Sudoku::maxSize};
+    engines[1] = {"dancing-links", SudokuSolver::Options(), Sudoku::maxSize};
+    engines[1].options.engine = SudokuSolver::Engine::dancingLinks;
+    engines[2] = {"most-constrained", SudokuSolver::Options(), 16};
+    engines[2].options.propagate = false;
+    engines[3] = {"raster", SudokuSolver::Options(), 9};
+    engines[3].options.cellOrder = SudokuSolver::CellOrder::raster;
+    engines[3].options.propagate = false;
+
+    // fewer puzzles on the larger boards, they take much longer to generate
+    const int sizes[] = {4, 9, 16, 25}, shares[] = {1, 1, 10, 50};
+    std::vector<Corpus> corpora;
+    for (int s = 0; s < 4; s++)
+        for (int difficulty = 1; difficulty < 5; difficulty++) {
+            Corpus corpus;
+            corpus.size = sizes[s];
+            corpus.difficulty = difficulty;
+            corpora.push_back(corpus);
+        }
+
+    long disagreements = 0;
+    for (size_t c = 0; c < corpora.size(); c++) {
+        Corpus& corpus = corpora[c];
+        int puzzles = std::max(2, count / shares[c / 4]);
+        runCorpus(corpus, puzzles, seed * 1000003ull + (corpus.size * 10 + corpus.difficulty) * 100000ull, engines);
+        for (long d : corpus.disagreements) disagreements += d;
+        std::cerr << corpus.size << "x" << corpus.size << " difficulty " << corpus.difficulty << ": " << puzzles
+                  << " puzzles, generate " << corpus.generate.mean() << " us, solve " << corpus.solve[0].mean()
+                  << " us, unique " << corpus.unique[0].mean() << " us, verify " << corpus.verify.mean() << " us\n";
+    }
+
+    FILE* out = output ? std::fopen(output, "w") : stdout;
+    if (!out) { std::cerr << "sudoku_bench: cannot open " << output << "\n"; return 1; }
+    std::fprintf(out, "{\n  \"seed\": %u,\n  \"count\": %d,\n  \"verify_kernel\": \"%s\",\n  \"disagreements\": %ld,\n  \"corpora\": [\n",
+                 seed, count, verifyKernel(9), disagreements);
+    for (size_t c = 0; c < corpora.size(); c++) {
+        Corpus& corpus = corpora[c];
+        double clues = 0;
+        uint64_t hash = 14695981039346656037ull; // FNV-1a of the puzzles, equal between runs with one seed
+        for (Sudoku* puzzle : corpus.puzzles) {
+            clues += puzzle->getNumClues();
+            for (int i = 0; i < puzzle->getNumCells(); i++) hash = (hash ^ puzzle->valueAt(i)) * 1099511628211ull;
+        }
+        std::fprintf(out, "    {\"size\": %d, \"difficulty\": %d, \"puzzles\": %zu, \"avg_clues\": %.2f, \"corpus_hash\": \"%016llx\",\n      ",
+                     corpus.size, corpus.difficulty, corpus.puzzles.size(), clues / corpus.puzzles.size(), (unsigned long long) hash);
+        writeTimings(out, "generate", corpus.generate);
+        std::fprintf(out, ",\n      ");
+        writeTimings(out, "verify", corpus.verify);
+        std::fprintf(out, ",\n      \"verify_batch_us\": %.3f,\n      \"engines\": [\n", corpus.verifyBatch);
+        bool first = true;
+        for (size_t e = 0; e < engines.size(); e++) {
+            if (corpus.size > engines[e].maxSize) continue;
+            std::fprintf(out, "%s        {\"name\": \"%s\", \"disagreements\": %ld, ", first ? "" : ",\n",
+                         engines[e].name, corpus.disagreements[e]);
+            writeTimings(out, "solve", corpus.solve[e]);
+            std::fprintf(out, ", ");
+            writeTimings(out, "unique", corpus.unique[e]);
+            std::fprintf(out, "}");
+            first = false;
+        }
+        std::fprintf(out, "\n      ]}%s\n", c + 1 < corpora.size() ? "," : "");
+        for (Sudoku* puzzle : corpus.puzzles) delete puzzle;
+        for (Sudoku* solution : corpus.solutions) delete solution;
+    }
+    std::fprintf(out, "  ]\n}\n");
+    if (output) std::fclose(out);
+
+    if (disagreements) std::cerr << "sudoku_bench: " << disagreements << " disagreements between engines\n";
+    return disagreements ? 1 : 0;
+}
@@ -0,0 +1,368 @@
+#include "canonical.h"
+
+#include <chrono>
+
+/* =========================================== */
+/* ============== CANONICAL FORM ============= */
+/* =========================================== */
+
+namespace {
+
+/* A set of symmetries being narrowed down: the board rows picked for the first canonical rows, the order
+   of the columns, the labels the digits of those rows received. Columns are grouped in cells of columns
+   that can still come in any order (cellStarts has a bit set where each starts), refined row by row */
+struct Candidate {
+    bool transposed;
+    int numLabels;
+    uint64_t usedRows;
+    uint64_t cellStarts;
+    uint8_t rows[Sudoku::maxSize];
+    uint8_t columns[Sudoku::maxSize];
+    uint8_t labels[Sudoku::maxSize + 1];
+};
+
+struct Workspace {
+    std::vector<Sudoku::Value> grids;               // the board, then its transpose
+    std::vector<Candidate> candidates, next;
+    std::vector<std::pair<int, int>> smallest;      // candidate and row giving the smallest next row
+    std::vector<int> best, keys;                    // keys of the smallest next row, of the row being tried
+};
+
+thread_local Workspace workspace;
+
+/* End of the cell starting at position j */
+inline int cellEnd(const Candidate& candidate, int j, int size) {
+    uint64_t later = (j + 1 < 64) ? candidate.cellStarts & (~uint64_t(0) << (j + 1)) : 0;
+    return later ? lowestBit(later) : size;
+}
+
+/* Keys of a row under the smallest column order the candidate allows: in each cell the empty cells (0),
+   then the labeled digits in increasing order, then the new digits (numbered in order, after all labels).
+   With compare, they are checked against best as they come and the search stops once they are larger.
+   Returns -1 if smaller than best (or without compare), 0 if equal, 1 if larger */
+int rowKeys(const Candidate& candidate, const Sudoku::Value* row, int size, int* keys, const int* best, bool compare) {
+    int fresh = candidate.numLabels, order = compare ? 0 : -1, pos = 0;
+    auto emit = [&](int key) {
+        keys[pos] = key;
+        if (order == 0 && key != best[pos]) order = key < best[pos] ? -1 : 1;
+        pos++;
+    };
+    for (int j = 0; j < size && order <= 0; ) {
+        int end = cellEnd(candidate, j, size), known[Sudoku::maxSize], numKnown = 0, numNew = 0;
+        for (int p = j; p < end; p++) {
+            int value = row[candidate.columns[p]];
+            if (value == 0) continue;
+            int label = candidate.labels[value];
+            if (!label) { numNew++; continue; }
+            int k = numKnown++;
+            for (; k > 0 && known[k-1] > label; k--) known[k] = known[k-1];
+            known[k] = label;
+        }
+        for (int k = numKnown + numNew; k < end - j; k++) emit(0);
+        for (int k = 0; k < numKnown; k++) emit(known[k]);
+        for (int k = 0; k < numNew; k++) emit(++fresh);
+        j = end;
+    }
+    return order;
+}
+
+/* Adds to next the candidates that give this row its smallest keys: every cell is split into its empty
+   cells, still in any order, its labeled digits, each on its own, and its new digits, each on its own and
+   in every order. False if that would make next larger than maxCandidates */
+bool refine(const Candidate& parent, const Sudoku::Value* row, int r, int level, int size,
+            std::vector<Candidate>& next, size_t maxCandidates) {
+    Candidate base = parent;
+    base.rows[level] = r;
+    base.usedRows |= uint64_t(1) << r;
+    uint8_t segments[Sudoku::maxSize][2];           // runs of new digits, to permute
+    int numSegments = 0;
+    double orders = 1;
+    for (int j = 0; j < size; ) {
+        int end = cellEnd(parent, j, size), numKnown = 0, numNew = 0;
+        uint8_t known[Sudoku::maxSize], fresh[Sudoku::maxSize], empty[Sudoku::maxSize];
+        int numEmpty = 0;
+        for (int p = j; p < end; p++) {
+            int column = parent.columns[p], value = row[column];
+            if (value == 0) empty[numEmpty++] = column;
+            else if (parent.labels[value]) {
+                int k = numKnown++;
+                for (; k > 0 && parent.labels[row[known[k-1]]] > parent.labels[value]; k--) known[k] = known[k-1];
+                known[k] = column;
+            }
+            else fresh[numNew++] = column;
+        }
+        std::sort(fresh, fresh + numNew);
+        int p = j;
+        for (int k = 0; k < numEmpty; k++) base.columns[p++] = empty[k];
+        for (int k = 0; k < numKnown; k++) base.columns[p++] = known[k];
+        if (numNew > 1) {
+            segments[numSegments][0] = p;
+            segments[numSegments++][1] = numNew;
+            for (int k = 2; k <= numNew; k++) orders *= k;
+        }
+        for (int k = 0; k < numNew; k++) base.columns[p++] = fresh[k];
+        for (int q = j; q < end; q++) {
+            bool start = q == j || q >= j + numEmpty;
+            if (start) base.cellStarts |= uint64_t(1) << q;
+            else base.cellStarts &= ~(uint64_t(1) << q);
+        }
+        j = end;
+    }
+    if (next.size() + orders > maxCandidates) return false;
+
+    while (true) {
+        next.push_back(base);
+        Candidate& candidate = next.back();
+        for (int j = 0; j < size; j++) {
+            int value = row[candidate.columns[j]];
+            if (value && !candidate.labels[value]) candidate.labels[value] = ++candidate.numLabels;
+        }
+        // next order: advance the first run that has a next permutation, resetting the ones before
+        int s = 0;
+        while (s < numSegments && !std::next_permutation(base.columns + segments[s][0], base.columns + segments[s][0] + segments[s][1])) s++;
+        if (s == numSegments) return true;
+    }
+}
+
+}
+
+bool canonicalize(const Sudoku& board, CanonicalForm& form, size_t maxCandidates) {
+    Workspace& ws = workspace;
+    int size = board.getSize(), boxSize = board.getBoxSize(), numCells = board.getNumCells();
+    ws.grids.resize(2 * numCells);
+    for (int y = 0; y < size; y++)
+        for (int x = 0; x < size; x++) ws.grids[y*size + x] = ws.grids[numCells + x*size + y] = board.valueAt(y*size + x);
+
+    // first row: the board rows whose stacks hold the fewest clues (sorted counts, smallest first), in either
+    // orientation. The stacks come by increasing clue count; those with equal counts in every order, each order
+    // a candidate with no rows yet
+    int best[Sudoku::maxSize], counts[Sudoku::maxSize], sorted[Sudoku::maxSize];
+    std::fill(best, best + boxSize, size + 1);
+    ws.candidates.clear();
+    ws.smallest.clear();
+    for (int t = 0; t < 2; t++)
+        for (int r = 0; r < size; r++) {
+            const Sudoku::Value* row = ws.grids.data() + t*numCells + r*size;
+            for (int s = 0; s < boxSize; s++) {
+                counts[s] = 0;
+                for (int c = s * boxSize; c < (s+1) * boxSize; c++) counts[s] += row[c] != 0;
+            }
+            std::copy(counts, counts + boxSize, sorted);
+            std::sort(sorted, sorted + boxSize);
+            if (std::lexicographical_compare(best, best + boxSize, sorted, sorted + boxSize)) continue;
+            if (!std::equal(sorted, sorted + boxSize, best)) {
+                std::copy(sorted, sorted + boxSize, best);
+                ws.candidates.clear();
+                ws.smallest.clear();
+            }
+            uint8_t stacks[Sudoku::maxSize];
+            for (int s = 0; s < boxSize; s++) stacks[s] = s;
+            std::stable_sort(stacks, stacks + boxSize, [&](int a, int b) { return counts[a] < counts[b]; });
+            do {
+                bool increasing = true;
+                for (int s = 1; s < boxSize; s++) increasing = increasing && counts[stacks[s-1]] <= counts[stacks[s]];
+                if (!increasing) continue;
+                if (ws.candidates.size() >= maxCandidates) return false;
+                Candidate candidate;
+                candidate.transposed = t;
+                candidate.numLabels = 0;
+                candidate.usedRows = 0;
+                candidate.cellStarts = 0;
+                std::fill(candidate.labels, candidate.labels + size + 1, 0);
+                for (int s = 0; s < boxSize; s++) {
+                    candidate.cellStarts |= uint64_t(1) << (s * boxSize);
+                    for (int c = 0; c < boxSize; c++) candidate.columns[s * boxSize + c] = stacks[s] * boxSize + c;
+                }
+                ws.smallest.emplace_back(ws.candidates.size(), r);
+                ws.candidates.push_back(candidate);
+            } while (std::next_permutation(stacks, stacks + boxSize, [&](int a, int b) {
+                return counts[a] != counts[b] ? counts[a] < counts[b] : a < b;
+            }));
+        }
+
+    // every next row: the rows, of the current band or of any new band, that give the smallest keys,
+    // keeping all the candidates that tie
+    ws.best.resize(size);
+    ws.keys.resize(size);
+    for (int level = 0; level < size; level++) {
+        if (level > 0) {
+            ws.smallest.clear();
+            bool found = false;
+            for (size_t k = 0; k < ws.candidates.size(); k++) {
+                const Candidate& candidate = ws.candidates[k];
+                int band = candidate.rows[level - 1] / boxSize;
+                int first = (level % boxSize) ? band * boxSize : 0, last = (level % boxSize) ? first + boxSize : size;
+                const Sudoku::Value* grid = ws.grids.data() + candidate.transposed * numCells;
+                for (int r = first; r < last; r++) {
+                    if ((candidate.usedRows >> r) & 1) continue;
+                    int order = rowKeys(candidate, grid + r*size, size, ws.keys.data(), ws.best.data(), found);
+                    if (order > 0) continue;
+                    if (order < 0) {
+                        ws.best.swap(ws.keys);
+                        ws.smallest.clear();
+                        found = true;
+                    }
+                    ws.smallest.emplace_back(k, r);
+                }
+            }
+        }
+
+        ws.next.clear();
+        for (auto& pick : ws.smallest) {
+            const Candidate& candidate = ws.candidates[pick.first];
+            const Sudoku::Value* row = ws.grids.data() + candidate.transposed * numCells + pick.second * size;
+            if (!refine(candidate, row, pick.second, level, size, ws.next, maxCandidates)) return false;
+        }
+        ws.candidates.swap(ws.next);
+    }
+
+    // the remaining candidates all give the same board (columns still in one cell are empty in every row);
+    // digits that never appear get the last labels
+    const Candidate& chosen = ws.candidates.front();
+    form.size = size;
+    form.transposed = chosen.transposed;
+    std::copy(chosen.rows, chosen.rows + size, form.rows);
+    std::copy(chosen.columns, chosen.columns + size, form.columns);
+    std::copy(chosen.labels, chosen.labels + size + 1, form.labels);
+    int numLabels = chosen.numLabels;
+    for (int v = 1; v <= size; v++)
+        if (!form.labels[v]) form.labels[v] = ++numLabels;
+
+    const Sudoku::Value* grid = ws.grids.data() + chosen.transposed * numCells;
+    form.values.resize(numCells);
+    form.hash = 14695981039346656037ull; // FNV-1a
+    for (int i = 0; i < size; i++)
+        for (int j = 0; j < size; j++) {
+            Sudoku::Value value = form.labels[grid[form.rows[i]*size + form.columns[j]]];
+            form.values[i*size + j] = value;
+            form.hash = (form.hash ^ value) * 1099511628211ull;
+        }
+    return true;
+}
+
+void toCanonical(const CanonicalForm& form, const Sudoku::Value* values, Sudoku::Value* canonical) {
+    int size = form.size;
+    for (int i = 0; i < size; i++)
+        for (int j = 0; j < size; j++) {
+            int r = form.rows[i], c = form.columns[j];
+            canonical[i*size + j] = form.labels[values[form.transposed ? c*size + r : r*size + c]];
+        }
+}
+
+void fromCanonical(const CanonicalForm& form, const Sudoku::Value* canonical, Sudoku::Value* values) {
+    int size = form.size;
+    Sudoku::Value digits[Sudoku::maxSize + 1];
+    for (int v = 0; v <= size; v++) digits[form.labels[v]] = v;
+    for (int i = 0; i < size; i++)
+        for (int j = 0; j < size; j++) {
+            int r = form.rows[i], c = form.columns[j];
+            values[form.transposed ? c*size + r : r*size + c] = digits[canonical[i*size + j]];
+        }
+}
+
+/* =========================================== */
+/* =============== RESULT CACHE ============== */
+/* =========================================== */
+
+ResultCache::ResultCache(size_t capacity, size_t maxCandidates)
+    : _shards(new Shard[numShards]), _shardCapacity(std::max<size_t>(1, capacity / numShards)), _maxCandidates(maxCandidates),
+      _lookups(0), _hits(0), _uncacheable(0), _evictions(0), _canonicalNanoseconds(0) {}
+
+int ResultCache::countSolutions(Sudoku& puzzle, int limit, const SudokuSolver::Options& options) {
+    if (limit > 2) return SudokuSolver::countSolutions(puzzle, limit, options);
+    thread_local CanonicalForm form;
+    thread_local std::vector<Sudoku::Value> values, solution;
+    int numCells = puzzle.getNumCells();
+    values.resize(numCells);
+    _lookups++;
+
+    std::chrono::steady_clock sc;
+    auto start = sc.now();
+    bool canonical = canonicalize(puzzle, form, _maxCandidates);
+    _canonicalNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(sc.now() - start).count();
+    if (!canonical) {
+        _uncacheable++;
+        return SudokuSolver::countSolutions(puzzle, limit, options);
+    }
+
+    Shard& shard = _shards[form.hash % numShards];
+    int found = -1;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto range = shard.index.equal_range(form.hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            Entry& entry = *it->second;
+            if (entry.board != form.values) continue;
+            if (entry.found < entry.limit || entry.limit >= limit) { // counted all solutions, or at least as far
+                shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+                found = std::min(entry.found, limit);
+                solution = entry.solution;
+            }
+            break;
+        }
+    }
+    if (found >= 0) {
+        _hits++;
+        if (found > 0) {
+            fromCanonical(form, solution.data(), values.data());
+            for (int i = 0; i < numCells; i++) puzzle.setValueAt(i, values[i]);
+        }
+        return found;
+    }
+
+    found = SudokuSolver::countSolutions(puzzle, limit, options);
+    if (found == SudokuSolver::gaveUp || options.cancelled()) return found; // out of budget, or may have missed solutions
+
+    Entry entry;
+    entry.hash = form.hash;
+    entry.board = form.values;
+    entry.found = found;
+    entry.limit = limit;
+    if (found > 0) {
+        for (int i = 0; i < numCells; i++) values[i] = puzzle.valueAt(i);
+        entry.solution.resize(numCells);
+        toCanonical(form, values.data(), entry.solution.data());
+    }
+
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    auto range = shard.index.equal_range(form.hash);
+    for (auto it = range.first; it != range.second; ++it)
+        if (it->second->board == entry.board) { // solved by another thread meanwhile, or with a smaller limit
+            *it->second = std::move(entry);
+            return found;
+        }
+    shard.entries.push_front(std::move(entry));
+    shard.index.emplace(form.hash, shard.entries.begin());
+    if (shard.entries.size() > _shardCapacity) {
+        auto oldest = std::prev(shard.entries.end());
+        auto range = shard.index.equal_range(oldest->hash);
+        for (auto it = range.first; it != range.second; ++it)
+            if (it->second == oldest) { shard.index.erase(it); break; }
+        shard.entries.pop_back();
+        _evictions++;
+    }
+    return found;
+}
+
+ResultCache::Stats ResultCache::stats() const {
+    Stats stats;
+    stats.lookups = _lookups;
+    stats.hits = _hits;
+    stats.uncacheable = _uncacheable;
+    stats.evictions = _evictions;
+    stats.canonicalSeconds = _canonicalNanoseconds * 1e-9;
+    stats.entries = 0;
+    for (int s = 0; s < numShards; s++) {
+        std::lock_guard<std::mutex> lock(_shards[s].mutex);
+        stats.entries += _shards[s].entries.size();
+    }
+    return stats;
+}
+
+void ResultCache::clear() {
+    for (int s = 0; s < numShards; s++) {
+        std::lock_guard<std::mutex> lock(_shards[s].mutex);
+        _shards[s].entries.clear();
+        _shards[s].index.clear();
+    }
+}
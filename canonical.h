@@ -0,0 +1,100 @@
+#ifndef CANONICAL_H
+#define CANONICAL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "sudoku.h"
+
+/* =========================================== */
+/* ============== CANONICAL FORM ============= */
+/* =========================================== */
+
+/* Boards that are the same up to transposition, band and row permutations, stack and column
+   permutations and relabeling of the digits form a symmetry class; they have the same number of
+   solutions, and a solution of one maps to a solution of the others.
+
+   The canonical form of a board is the smallest board of its class, reading cells row by row, where
+   digits are relabeled in order of first appearance and empty cells are 0. It is found row by row:
+   only the symmetries giving the smallest first rows are kept (sparse rows first, which leaves most
+   columns free to move), then those giving the smallest second rows, and so on. Boards with many
+   symmetries keep many candidates; past a limit canonicalize gives up, for every board of the class alike */
+struct CanonicalForm {
+    int size;
+    bool transposed;                        // the board is transposed first
+    uint8_t rows[Sudoku::maxSize];          // canonical row i is row rows[i] of the (transposed) board
+    uint8_t columns[Sudoku::maxSize];       // canonical column j is column columns[j]
+    uint8_t labels[Sudoku::maxSize + 1];    // board digit -> canonical digit, 0 stays 0
+    std::vector<Sudoku::Value> values;      // canonical cells, row-major
+    uint64_t hash;                          // of values, equal for the whole class
+};
+
+/* False if the board has too many symmetries to settle with at most maxCandidates candidates */
+bool canonicalize(const Sudoku& board, CanonicalForm& form, size_t maxCandidates = 1 << 14);
+
+/* Turns cells of the original board (such as its solution) into cells of the canonical board */
+void toCanonical(const CanonicalForm& form, const Sudoku::Value* values, Sudoku::Value* canonical);
+
+/* Turns cells of the canonical board back into cells of the original board */
+void fromCanonical(const CanonicalForm& form, const Sudoku::Value* canonical, Sudoku::Value* values);
+
+/* =========================================== */
+/* =============== RESULT CACHE ============== */
+/* =========================================== */
+
+/* Solution counts and first solutions of canonical boards, shared by any number of threads, so a board
+   of an already solved class is answered without searching. The cache is split into shards, each a hash
+   table under its own lock that forgets its least recently used board when full. Whole boards are compared,
+   the hash only picks the shard and bucket */
+class ResultCache {
+public:
+    struct Stats {
+        long lookups, hits;
+        long uncacheable;           // boards canonicalize gave up on, solved without the cache
+        long entries, evictions;
+        double canonicalSeconds;    // spent canonicalizing, over all lookups
+    };
+
+private:
+    struct Entry {
+        uint64_t hash;
+        std::vector<Sudoku::Value> board, solution; // canonical, solution empty if there is none
+        int found, limit;                           // countSolutions result with this limit
+    };
+
+    struct Shard {
+        std::mutex mutex;
+        std::list<Entry> entries;                   // most recently used first
+        std::unordered_multimap<uint64_t, std::list<Entry>::iterator> index;
+    };
+
+    static const int numShards = 16;
+
+    std::unique_ptr<Shard[]> _shards;
+    size_t _shardCapacity, _maxCandidates;
+    std::atomic<long> _lookups, _hits, _uncacheable, _evictions, _canonicalNanoseconds;
+
+public:
+    /* capacity boards at most; maxCandidates bounds the cost of canonicalize on very symmetric boards */
+    explicit ResultCache(size_t capacity = 1 << 16, size_t maxCandidates = 4096);
+
+    ResultCache(const ResultCache&) = delete;
+
+    ResultCache& operator=(const ResultCache&) = delete;
+
+    /* Same result as SudokuSolver::countSolutions: the board is left holding the first solution, mapped
+       back from the cached one on a hit. Limits above 2 bypass the cache */
+    int countSolutions(Sudoku& puzzle, int limit, const SudokuSolver::Options& options = SudokuSolver::Options());
+
+    Stats stats() const;
+
+    void clear();
+};
+
+#endif
@@ -0,0 +1,295 @@
+#include "cluetarget.h"
+
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+
+/* =========================================== */
+/* ========== TARGET CLUE GENERATOR ========== */
+/* =========================================== */
+
+static const int perturbationsPerGrid = 50; // in a row without fewer clues before starting over from a new grid
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+Sudoku emptyBoard(int size) {
+    if (size < 1 || size > Sudoku::maxSize) throw std::invalid_argument("Sudoku size must be at most 49.");
+    std::vector<Sudoku::Value> values(size * size, 0);
+    return Sudoku(size, values.data());
+}
+
+/* State shared by the caller and the pool tasks (kept alive by the last of them) */
+struct ClueSearch {
+    int size;
+    ClueTarget target;
+    Clock::time_point deadline;
+
+    std::atomic<bool> stop;             // target reached or budget spent: cancels the searches of every attempt
+    std::atomic<long> nodes;            // spent by all attempts
+
+    std::mutex mutex;
+    std::condition_variable allDone;
+    int running = 0;                    // racers started and not finished
+    std::unique_ptr<Sudoku> best;       // an empty board until the first offer
+    int bestClues;
+    bool bestMinimal = false;
+    ClueReport report;                  // attempts, perturbations and stats of the finished racers
+
+    ClueSearch(int boardSize, const ClueTarget& clueTarget)
+        : size(boardSize), target(clueTarget), deadline(Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(clueTarget.seconds))),
+          stop(false), nodes(0), best(new Sudoku(emptyBoard(boardSize))), bestClues(boardSize * boardSize + 1) {}
+
+    bool reached(int numClues) const { return target.numClues > 0 && numClues <= target.numClues; }
+
+    bool spent() const { return (target.seconds > 0 && Clock::now() >= deadline) || (target.nodeBudget > 0 && nodes >= target.nodeBudget); }
+
+    /* Notes the budget running out, so that the other attempts stop too */
+    bool shouldStop() {
+        if (stop) return true;
+        if (spent()) stop = true;
+        return stop;
+    }
+
+    void offer(const Sudoku& puzzle, int numClues, bool minimal);
+
+    void race(uint64_t seed);
+};
+
+/* Keeps the puzzle if it has the fewest clues so far */
+void ClueSearch::offer(const Sudoku& puzzle, int numClues, bool minimal) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (numClues >= bestClues) return;
+    *best = puzzle;
+    bestClues = numClues;
+    bestMinimal = minimal;
+    if (reached(numClues)) stop = true;
+}
+
+/* One search per clue, within what is left of the budget of the search if there is one (checked between searches,
+   like the attempts do): unknown when it runs out first */
+Minimality minimality(const Sudoku& puzzle, SudokuSolver::Options options, ClueSearch* budget) {
+    SudokuSolver::SolverStats stats;
+    if (!options.stats) options.stats = &stats;
+    options.cancel = nullptr;
+    options.nodeBudget = 0;
+    Sudoku clues = puzzle;
+    for (int i = 0; i < clues.getNumCells(); i++) clues.setValueAt(i, 0); // drafts are not part of the puzzle
+
+    // true when the search may go on, the node budget of the next search set
+    auto left = [&] {
+        if (!budget) return true;
+        if (budget->spent()) return false;
+        if (budget->target.nodeBudget > 0) options.nodeBudget = budget->target.nodeBudget - budget->nodes;
+        return true;
+    };
+    // adds the nodes of a search to the budget, false if it gave up
+    auto spend = [&](long nodesBefore, long outOfBudgetBefore) {
+        if (budget) budget->nodes += options.stats->nodes - nodesBefore;
+        return options.stats->outOfBudget == outOfBudgetBefore;
+    };
+
+    if (!left()) return Minimality::unknown;
+    long nodes = options.stats->nodes, outOfBudget = options.stats->outOfBudget;
+    Sudoku solution = clues;
+    int found = SudokuSolver::countSolutions(solution, 2, options);
+    if (!spend(nodes, outOfBudget)) return Minimality::unknown;
+    if (found != 1) return Minimality::no;
+
+    for (int i = 0; i < clues.getNumCells(); i++) {
+        if (clues.isDraftAt(i)) continue;
+        if (!left()) return Minimality::unknown;
+        nodes = options.stats->nodes;
+        outOfBudget = options.stats->outOfBudget;
+        int value = clues.valueAt(i);
+        clues.setClueAt(i, 0);
+        bool needed = SudokuSolver::hasSolutionWithout(clues, i, value, options);
+        clues.setClueAt(i, value);
+        if (!spend(nodes, outOfBudget)) return Minimality::unknown; // giving up counts as found
+        if (!needed) return Minimality::no;
+    }
+    return Minimality::yes;
+}
+
+/* Attempts one after another on one thread */
+class Racer {
+    enum Mark : char { untried, kept, putBack }; // state of a clue in the current clearing pass
+
+    ClueSearch& _search;
+    Random _random;
+    Sudoku _puzzle;                     // clues and empty cells
+    Sudoku _solution;
+    Sudoku _saved;                      // puzzle before the last perturbation
+    int _numClues;
+    std::vector<int> _unitClues;        // clues of each unit: rows, columns, boxes
+    std::vector<Mark> _marks;           // one per cell
+    SudokuSolver::Options _options;
+
+public:
+    long attempts = 0, perturbations = 0;
+    SudokuSolver::SolverStats stats;
+
+    Racer(ClueSearch& search, int size, uint64_t seed)
+        : _search(search), _random(seed), _puzzle(emptyBoard(size)), _solution(_puzzle), _saved(_puzzle),
+          _numClues(0), _unitClues(3 * size), _marks(size * size) {
+        _options.cancel = &search.stop;
+        _options.stats = &stats;
+    }
+
+    void run();
+
+private:
+    void units(int i, int unit[3]) const;
+
+    bool clear();
+
+    void perturb();
+};
+
+void Racer::units(int i, int unit[3]) const {
+    int size = _puzzle.getSize(), boxSize = _puzzle.getBoxSize(), x = i % size, y = i / size;
+    unit[0] = y;
+    unit[1] = size + x;
+    unit[2] = 2*size + (y / boxSize) * boxSize + x / boxSize;
+}
+
+/* Clears clues until none can go, the target is reached or the search stops. True if the puzzle is then minimal.
+   A clue that cannot go stays for the rest of the pass: clearing others only allows more solutions */
+bool Racer::clear() {
+    SudokuSolver::PhaseTimer timer(&stats.clearSeconds);
+    int unit[3];
+    std::fill(_unitClues.begin(), _unitClues.end(), 0);
+    for (int i = 0; i < _puzzle.getNumCells(); i++) {
+        if (_puzzle.isDraftAt(i)) continue;
+        units(i, unit);
+        for (int u = 0; u < 3; u++) _unitClues[unit[u]]++;
+    }
+
+    while (!_search.reached(_numClues) && !_search.shouldStop()) {
+        // the clue in the most crowded units, at random among equals; the ones put back come last
+        int cell = -1, bestScore = -1, ties = 0;
+        for (int i = 0; i < _puzzle.getNumCells(); i++) {
+            if (_puzzle.isDraftAt(i) || _marks[i] == kept) continue;
+            units(i, unit);
+            int score = (_marks[i] == putBack) ? 0 : 1 + _unitClues[unit[0]] + _unitClues[unit[1]] + _unitClues[unit[2]];
+            if (score > bestScore) { cell = i; bestScore = score; ties = 1; }
+            else if (score == bestScore && _random.uniform(0, ties++) == 0) cell = i;
+        }
+        if (cell < 0) return true;
+
+        int value = _solution.valueAt(cell);
+        _puzzle.setClueAt(cell, 0);
+        long before = stats.nodes;
+        _options.nodeBudget = (_search.target.nodeBudget > 0) ? std::max(1L, _search.target.nodeBudget - _search.nodes) : 0;
+        bool rejected = SudokuSolver::hasSolutionWithout(_puzzle, cell, value, _options); // giving up keeps the clue
+        _search.nodes += stats.nodes - before;
+        SUDOKU_STAT({
+            stats.uniquenessChecks++;
+            stats.rejectedClears += rejected;
+        });
+        if (!rejected && _search.stop) rejected = true; // a cancelled search proves nothing
+        if (rejected) {
+            _puzzle.setClueAt(cell, value);
+            _marks[cell] = kept;
+            continue;
+        }
+        units(cell, unit);
+        for (int u = 0; u < 3; u++) _unitClues[unit[u]]--;
+        _numClues--;
+    }
+    return false;
+}
+
+/* Puts back one or two cleared clues, and lets every clue be tried again */
+void Racer::perturb() {
+    std::fill(_marks.begin(), _marks.end(), untried);
+    int numCells = _puzzle.getNumCells(), toPut = std::min(_random.uniform(1, 2), numCells - _numClues);
+    while (toPut > 0) {
+        int i = _random.uniform(0, numCells - 1);
+        if (!_puzzle.isDraftAt(i)) continue;
+        _puzzle.setClueAt(i, _solution.valueAt(i));
+        _marks[i] = putBack;
+        _numClues++;
+        toPut--;
+    }
+    perturbations++;
+}
+
+void Racer::run() {
+    do { // always one grid, so that there is a puzzle even without budget
+        _puzzle.fillGrid(_random, &stats);
+        _solution = _puzzle;
+        _numClues = _puzzle.getNumCells();
+        std::fill(_marks.begin(), _marks.end(), untried);
+        attempts++;
+        bool minimal = clear();
+        _search.offer(_puzzle, _numClues, minimal);
+
+        for (int stale = 0; stale < perturbationsPerGrid && !_search.shouldStop(); stale++) {
+            _saved = _puzzle;
+            int savedClues = _numClues;
+            perturb();
+            minimal = clear();
+            if (_numClues > savedClues) { // worse (or cut short): back to the puzzle before
+                _puzzle = _saved;
+                _numClues = savedClues;
+                continue;
+            }
+            if (_numClues < savedClues) stale = -1;
+            _search.offer(_puzzle, _numClues, minimal);
+        }
+    } while (!_search.shouldStop());
+}
+
+/* Pool tasks that start once the search has stopped leave at once, so the caller only waits for running ones */
+void ClueSearch::race(uint64_t seed) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stop) return;
+        running++;
+    }
+    Racer racer(*this, size, seed);
+    racer.run();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    report.attempts += racer.attempts;
+    report.perturbations += racer.perturbations;
+    report.stats += racer.stats;
+    if (--running == 0) allDone.notify_all();
+}
+
+}
+
+Sudoku generateWithClues(int size, const ClueTarget& target, Random& random, ClueReport* report, ThreadPool* pool) {
+    Clock::time_point start = Clock::now();
+    if (target.numClues < 0 || target.numClues > size * size) throw std::invalid_argument("Clue target must be between 0 and the number of cells.");
+    if (target.seconds <= 0 && target.nodeBudget <= 0) throw std::invalid_argument("Clue target needs a time or node budget.");
+
+    std::shared_ptr<ClueSearch> search = std::make_shared<ClueSearch>(size, target); // throws for an invalid size
+
+    if (pool)
+        for (int w = 0; w < pool->size(); w++) {
+            uint64_t seed = random.next();
+            pool->submit([search, seed](int) { search->race(seed); });
+        }
+    search->race(random.next());
+
+    std::unique_lock<std::mutex> lock(search->mutex);
+    search->allDone.wait(lock, [&] { return search->running == 0; });
+    Sudoku puzzle = *search->best;
+    if (report) {
+        *report = search->report;
+        report->numClues = search->bestClues;
+        report->reached = search->reached(search->bestClues);
+        SudokuSolver::Options options;
+        options.stats = &report->stats;
+        report->minimal = search->bestMinimal ? Minimality::yes : minimality(puzzle, options, search.get());
+        report->seconds = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    return puzzle;
+}
+
+bool isMinimal(const Sudoku& puzzle, const SudokuSolver::Options& options) {
+    return minimality(puzzle, options, nullptr) == Minimality::yes;
+}
@@ -0,0 +1,47 @@
+#ifndef CLUETARGET_H
+#define CLUETARGET_H
+
+#include "sudoku.h"
+#include "threadpool.h"
+
+/* =========================================== */
+/* ========== TARGET CLUE GENERATOR ========== */
+/* =========================================== */
+
+/* Generates unique puzzles with as few clues as it can, down to a requested number, within a budget.
+   Each attempt fills a grid and clears it into a minimal puzzle, trying first the clues whose row, column
+   and box hold the most clues. It then puts back a clue or two and clears again, keeping the result when it
+   has no more clues, and starts over from a new grid when that stops helping. With a pool, one attempt runs
+   on every worker and on the calling thread, and the first to reach the target stops the others. The caller
+   may be a worker of the pool: it only waits for the attempts that started before the search stopped */
+
+struct ClueTarget {
+    int numClues = 0;                   // stop at this many clues, 0 for the fewest found within the budget
+    double seconds = 1;                 // time budget, 0 for none
+    long nodeBudget = 0;                // search nodes shared by all attempts, 0 for none
+};
+
+/* Whether clearing any one clue of a puzzle would allow a second solution */
+enum class Minimality { no, yes, unknown };
+
+/* What generateWithClues did */
+struct ClueReport {
+    int numClues = 0;                   // clues of the puzzle returned
+    bool reached = false;               // numClues is at most the target
+    Minimality minimal = Minimality::unknown; // when the last clearing pass was cut short, checked with what is left
+                                        // of the budget: unknown if that runs out too
+    long attempts = 0;                  // grids filled
+    long perturbations = 0;             // clues put back to clear again
+    double seconds = 0;
+    SudokuSolver::SolverStats stats;    // of every search and generation
+};
+
+/* Returns the best puzzle found when the target is reached or the budget is spent. The time budget is checked
+   between searches, so one long search may overrun it. Throws std::invalid_argument for an invalid size or
+   target, or when there is neither a time nor a node budget */
+Sudoku generateWithClues(int size, const ClueTarget& target, Random& random, ClueReport* report = nullptr, ThreadPool* pool = nullptr);
+
+/* No clue can be cleared without allowing a second solution: one search per clue, without node budget or cancel */
+bool isMinimal(const Sudoku& puzzle, const SudokuSolver::Options& options = SudokuSolver::Options());
+
+#endif
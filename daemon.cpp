@@ -0,0 +1,656 @@
+#include "daemon.h"
+#include "puzzleio.h"
+#include "verify.h"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <deque>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/* =========================================== */
+/* ================ AUXILIARY ================ */
+/* =========================================== */
+
+/* Next blank-separated word of [pos, end), false if there is none */
+static bool nextWord(const char*& pos, const char* end, const char*& word, size_t& length) {
+    while (pos < end && (*pos == ' ' || *pos == '\t' || *pos == '\r')) pos++;
+    if (pos == end) return false;
+    word = pos;
+    while (pos < end && *pos != ' ' && *pos != '\t' && *pos != '\r') pos++;
+    length = pos - word;
+    return true;
+}
+
+static bool isWord(const char* word, size_t length, const char* name) {
+    return std::strlen(name) == length && std::memcmp(word, name, length) == 0;
+}
+
+/* Decimal number of at most 18 digits */
+static bool parseNumber(const char* word, size_t length, uint64_t& value) {
+    if (length == 0 || length > 18) return false;
+    value = 0;
+    for (size_t i = 0; i < length; i++) {
+        if (word[i] < '0' || word[i] > '9') return false;
+        value = value*10 + (word[i] - '0');
+    }
+    return true;
+}
+
+/* Writes all of data, false if the descriptor fails (the peer went away) */
+static bool writeAll(int fd, const char* data, size_t length) {
+    while (length > 0) {
+        ssize_t n = write(fd, data, length);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        length -= n;
+    }
+    return true;
+}
+
+/* Socket connected to a daemon listening at path. Throws std::runtime_error if there is none */
+static int connectTo(const char* path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(address.sun_path)) throw std::runtime_error(std::string("Socket path too long: ") + path);
+    std::strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) throw std::runtime_error("Cannot create a socket");
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        throw std::runtime_error(std::string("Cannot connect to ") + path);
+    }
+    return fd;
+}
+
+/* =========================================== */
+/* ================= DAEMON ================== */
+/* =========================================== */
+
+/* Requests answered together, with their replies */
+struct SolverDaemon::Batch {
+    std::vector<char> input;    // request lines, each followed by a newline
+    std::vector<char> output;
+};
+
+/* Warm state of one pool worker: boards and buffers reused from request to request */
+struct SolverDaemon::Worker {
+    SudokuSolver::Options solver;
+    Random random;                          // for generate without a seed
+    std::vector<Sudoku::Value> values;      // a puzzle, then a solution
+    Sudoku* puzzle;                         // reused while the board size does not change
+    Sudoku* generated;                      // same, for generate
+
+    explicit Worker(const SudokuSolver::Options& options)
+        : solver(options), random(Random::freshSeed()), values(2 * Sudoku::maxSize * Sudoku::maxSize),
+          puzzle(nullptr), generated(nullptr) {}
+
+    ~Worker() { delete puzzle; delete generated; }
+
+    /* Longest reply to a request line, but for the board of generate: its size is only known once parsed */
+    static size_t maxReply(size_t length) { return length + maxSolutionLength(length) + 80; }
+
+    bool load(const char* word, size_t length);
+
+    size_t answer(const char* line, size_t length, std::vector<char>& output, size_t used, bool& error);
+
+    void answer(Batch& batch, long& requests, long& errors);
+};
+
+/* Puts a puzzle word on the puzzle board, false if it is not a puzzle */
+bool SolverDaemon::Worker::load(const char* word, size_t length) {
+    int size = parsePuzzle(word, length, values.data());
+    if (size == 0) return false;
+    if (!puzzle || puzzle->getSize() != size) {
+        delete puzzle;
+        puzzle = nullptr;
+        puzzle = new Sudoku(size, values.data());
+    }
+    else puzzle->load(values.data());
+    return true;
+}
+
+/* Writes the reply to a request line (with newline) at the end of output, from used on, growing it to fit.
+   Returns the number of characters, 0 for a blank line */
+size_t SolverDaemon::Worker::answer(const char* line, size_t length, std::vector<char>& output, size_t used, bool& error) {
+    const char* pos = line,* end = line + length,* word;
+    size_t wordLength;
+    error = false;
+    if (!nextWord(pos, end, word, wordLength)) return 0; // blank line
+
+    output.resize(used + maxReply(length));
+    char* start = output.data() + used,* out = start;
+    std::memcpy(out, word, wordLength); // request id
+    out += wordLength;
+    *out++ = ' ';
+    char* result = out;
+    auto put = [&](const char* text) { size_t n = std::strlen(text); std::memcpy(out, text, n); out += n; };
+    auto grow = [&](size_t more) { // room for more characters and the newline; output may move
+        size_t at = out - output.data(), from = result - output.data();
+        if (at + more + 1 <= output.size()) return;
+        output.resize(at + more + 1);
+        start = output.data() + used;
+        result = output.data() + from;
+        out = output.data() + at;
+    };
+
+    const char* failure = nullptr;
+    try {
+        bool command = nextWord(pos, end, word, wordLength);
+        bool solve = command && isWord(word, wordLength, "solve"), count = command && isWord(word, wordLength, "count");
+        bool unique = command && isWord(word, wordLength, "unique");
+        uint64_t limit = unique ? 2 : 1, size, difficulty, seed;
+
+        if (!command) failure = "missing command";
+        else if (solve || count || unique) {
+            if (count && (!nextWord(pos, end, word, wordLength) || !parseNumber(word, wordLength, limit) || limit < 1 || limit > 1 << 30))
+                failure = "invalid limit";
+            else if (!nextWord(pos, end, word, wordLength) || !load(word, wordLength)) failure = "invalid puzzle";
+            else {
+                int found = puzzle->hasConflicts() ? 0 : SudokuSolver::countSolutions(*puzzle, limit, solver);
+                if (found == SudokuSolver::gaveUp) put("gave-up");
+                else if (count) out += std::sprintf(out, "%d", found);
+                else if (unique) put(found == 0 ? "unsolvable" : found == 1 ? "unique" : "multiple");
+                else if (found > 0) out += formatPuzzle(*puzzle, out); // board holds the solution
+                else put("none");
+            }
+        }
+        else if (isWord(word, wordLength, "generate")) {
+            bool seeded = false;
+            if (!nextWord(pos, end, word, wordLength) || !parseNumber(word, wordLength, size) || size < 1 || size > Sudoku::maxSize)
+                failure = "invalid size";
+            else if (!nextWord(pos, end, word, wordLength) || !parseNumber(word, wordLength, difficulty) || difficulty < 1 || difficulty > 4)
+                failure = "invalid difficulty";
+            else if ((seeded = nextWord(pos, end, word, wordLength)) && !parseNumber(word, wordLength, seed))
+                failure = "invalid seed";
+            else {
+                Random seededRandom(seeded ? seed : 0);
+                Random& source = seeded ? seededRandom : random;
+                if (generated && generated->getSize() == (int) size) generated->generate(difficulty, source);
+                else {
+                    delete generated;
+                    generated = nullptr;
+                    generated = new Sudoku(difficulty, size, source);
+                }
+                grow(maxLineLength(size));
+                out += formatPuzzle(*generated, out);
+            }
+        }
+        else if (isWord(word, wordLength, "verify")) {
+            const char* first,* second;
+            size_t firstLength, secondLength;
+            Sudoku::Value* clues = values.data(),* grid = clues + Sudoku::maxSize * Sudoku::maxSize;
+            bool given = nextWord(pos, end, first, firstLength), both = given && nextWord(pos, end, second, secondLength);
+            int gridSize = !given ? 0 : both ? parsePuzzle(second, secondLength, grid) : parsePuzzle(first, firstLength, grid);
+            if (gridSize == 0) failure = "invalid solution";
+            else if (both && parsePuzzle(first, firstLength, clues) != gridSize) failure = "invalid puzzle";
+            else {
+                bool ok;
+                verifySolutions(gridSize, both ? clues : nullptr, grid, 1, &ok);
+                put(ok ? "valid" : "invalid");
+            }
+        }
+        else failure = "unknown command";
+    }
+    catch (const std::exception& e) { // e.g. a board the generator does not support
+        error = true;
+        out = result + std::snprintf(result, 72, "error %.64s", e.what());
+    }
+    if (failure) {
+        error = true;
+        put("error ");
+        put(failure);
+    }
+    *out++ = '\n';
+    return out - start;
+}
+
+void SolverDaemon::Worker::answer(Batch& batch, long& requests, long& errors) {
+    size_t used = 0, pos = 0;
+    while (pos < batch.input.size()) {
+        const char* line = batch.input.data() + pos;
+        size_t length = static_cast<const char*>(std::memchr(line, '\n', batch.input.size() - pos)) - line;
+        pos += length + 1;
+
+        bool error;
+        size_t written = answer(line, length, batch.output, used, error);
+        used += written;
+        requests += written > 0;
+        errors += error;
+    }
+    batch.output.resize(used);
+}
+
+/* One input being served. Its replies are written a whole batch at a time by a thread of the connection,
+   so a client slow to read only holds up its own batches, never the pool workers */
+struct SolverDaemon::Connection {
+    int outFd;
+    bool broken = false;                // the peer went away, replies are dropped (writer thread only)
+    std::mutex mutex;
+    std::condition_variable done;       // a batch was written
+    std::condition_variable answered;   // a batch is ready to write, or the input ended
+    std::deque<std::shared_ptr<Batch>> ready;
+    size_t inFlight = 0;                // batches submitted and not written
+    bool closing = false;               // no more batches will come
+
+    explicit Connection(int fd) : outFd(fd) {}
+
+    void writeReplies();
+};
+
+/* Writes the answered batches in the order they finish, until closing */
+void SolverDaemon::Connection::writeReplies() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        answered.wait(lock, [&] { return !ready.empty() || closing; });
+        if (ready.empty()) return;
+        std::shared_ptr<Batch> batch = std::move(ready.front());
+        ready.pop_front();
+        lock.unlock();
+        if (!broken && !writeAll(outFd, batch->output.data(), batch->output.size())) broken = true;
+        lock.lock();
+        inFlight--;
+        done.notify_all();
+    }
+}
+
+SolverDaemon::SolverDaemon(const DaemonOptions& options)
+    : _options(options), _pool(options.threads), _requests(0), _batches(0), _errors(0), _connections(0), _stopping(false) {
+    _options.batchSize = std::max(1, _options.batchSize);
+    for (int w = 0; w < _pool.size(); w++) _workers.emplace_back(new Worker(_options.solver));
+}
+
+SolverDaemon::~SolverDaemon() {
+    _pool.wait(); // the workers go before the pool
+}
+
+SolverDaemon::Stats SolverDaemon::stats() const {
+    Stats stats;
+    stats.requests = _requests;
+    stats.batches = _batches;
+    stats.errors = _errors;
+    stats.connections = _connections;
+    return stats;
+}
+
+/* Queues a batch on the pool, first waiting while the connection has a few batches per worker not written yet */
+void SolverDaemon::submit(Connection& connection, std::shared_ptr<Batch> batch) {
+    {
+        std::unique_lock<std::mutex> lock(connection.mutex);
+        connection.done.wait(lock, [&] { return connection.inFlight < 4 * (size_t) _pool.size(); });
+        connection.inFlight++;
+    }
+    _batches++;
+    _pool.submit([this, &connection, batch](int worker) {
+        long requests = 0, errors = 0;
+        _workers[worker]->answer(*batch, requests, errors);
+        _requests += requests;
+        _errors += errors;
+
+        std::lock_guard<std::mutex> lock(connection.mutex);
+        connection.ready.push_back(batch);
+        connection.answered.notify_one();
+    });
+}
+
+/* Lines that arrive with one read are answered together, in batches of at most batchSize:
+   batches grow with the load and a lone request does not wait for others */
+void SolverDaemon::serve(int inFd, int outFd) {
+    _connections++;
+    Connection connection(outFd);
+    std::thread writer([&connection] { connection.writeReplies(); });
+    std::vector<char> buffer(1 << 16);
+    size_t used = 0;
+    std::shared_ptr<Batch> batch;
+    int numLines = 0;
+
+    auto dispatch = [&]() {
+        if (numLines == 0) return;
+        submit(connection, std::move(batch));
+        batch = nullptr;
+        numLines = 0;
+    };
+    auto add = [&](const char* line, size_t length) {
+        if (!batch) batch = std::make_shared<Batch>();
+        batch->input.insert(batch->input.end(), line, line + length);
+        batch->input.push_back('\n');
+        if (++numLines == _options.batchSize) dispatch();
+    };
+
+    while (true) {
+        ssize_t n = read(inFd, buffer.data() + used, buffer.size() - used);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+
+        size_t begin = 0, end = used + n;
+        const char* newline;
+        while ((newline = static_cast<const char*>(std::memchr(buffer.data() + begin, '\n', end - begin)))) {
+            add(buffer.data() + begin, newline - (buffer.data() + begin));
+            begin = newline - buffer.data() + 1;
+        }
+        dispatch();
+
+        used = end - begin; // keep the start of the next line
+        std::memmove(buffer.data(), buffer.data() + begin, used);
+        if (used == buffer.size()) buffer.resize(2 * buffer.size());
+    }
+    if (used > 0) add(buffer.data(), used); // last line without newline
+    dispatch();
+
+    {
+        std::unique_lock<std::mutex> lock(connection.mutex);
+        connection.done.wait(lock, [&] { return connection.inFlight == 0; });
+        connection.closing = true;
+        connection.answered.notify_one();
+    }
+    writer.join();
+}
+
+void SolverDaemon::listen(const char* path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (std::strlen(path) >= sizeof(address.sun_path)) throw std::runtime_error(std::string("Socket path too long: ") + path);
+    std::strcpy(address.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) throw std::runtime_error("Cannot create a socket");
+    unlink(path); // left behind by a daemon that did not stop cleanly
+    if (bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(fd, 128) < 0) {
+        close(fd);
+        throw std::runtime_error(std::string("Cannot listen on ") + path);
+    }
+
+    while (!_stopping) {
+        pollfd poller = {fd, POLLIN, 0};
+        if (poll(&poller, 1, 100) <= 0) continue; // wake up now and then to see stop()
+        int client = accept(fd, nullptr, nullptr);
+        if (client < 0) continue;
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        _open.insert(client);
+        std::thread([this, client] {
+            serve(client, client);
+            {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _open.erase(client);
+                _closed.notify_all();
+            }
+            close(client);
+        }).detach();
+    }
+    close(fd);
+    unlink(path);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (int client : _open) shutdown(client, SHUT_RD); // their serve sees the end of the input
+    _closed.wait(lock, [&] { return _open.empty(); });
+}
+
+/* ================ COMMAND ================== */
+
+static std::atomic<SolverDaemon*> signalled(nullptr); // stopped by SIGINT and SIGTERM
+
+static void stopDaemon(int) {
+    if (SolverDaemon* daemon = signalled.load()) daemon->stop();
+}
+
+static int daemonUsage() {
+    std::cerr << "usage: sudoku --daemon [--socket=<path>] [--threads[=N]] [--batch=N] [--dlx] [--budget=N]\n";
+    return 2;
+}
+
+int runDaemon(int argc, char* argv[]) {
+    DaemonOptions options;
+    const char* socketPath = nullptr;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--socket=", 0) == 0) socketPath = argv[i] + 9;
+        else if (arg == "--threads") options.threads = 0;
+        else if (arg.rfind("--threads=", 0) == 0) options.threads = std::max(0, std::atoi(arg.c_str() + 10));
+        else if (arg.rfind("--batch=", 0) == 0) options.batchSize = std::max(1, std::atoi(arg.c_str() + 8));
+        else if (arg == "--dlx") options.solver.engine = SudokuSolver::Engine::dancingLinks;
+        else if (arg.rfind("--budget=", 0) == 0) options.solver.nodeBudget = std::max(0L, std::atol(arg.c_str() + 9));
+        else return daemonUsage();
+    }
+    signal(SIGPIPE, SIG_IGN); // a client that goes away only loses its replies
+
+    std::chrono::steady_clock sc;
+    auto start = sc.now();
+    try {
+        SolverDaemon daemon(options);
+        if (socketPath) {
+            signalled = &daemon;
+            signal(SIGINT, stopDaemon);
+            signal(SIGTERM, stopDaemon);
+            std::cerr << "sudoku: listening on " << socketPath << "\n";
+            daemon.listen(socketPath);
+            signalled = nullptr;
+        }
+        else daemon.serve(0, 1);
+
+        SolverDaemon::Stats stats = daemon.stats();
+        double seconds = static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+        std::cerr << stats.requests << " requests in " << stats.batches << " batches ("
+                  << (stats.batches ? (double) stats.requests / stats.batches : 0) << " per batch) from "
+                  << stats.connections << " connections in " << seconds << " s, " << stats.errors << " errors\n";
+    }
+    catch (const std::exception& e) {
+        std::cerr << "sudoku: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
+
+/* =========================================== */
+/* ================= CLIENT ================== */
+/* =========================================== */
+
+int runClient(int argc, char* argv[]) {
+    const char* socketPath = nullptr;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--socket=", 0) == 0) socketPath = argv[i] + 9;
+        else socketPath = nullptr, i = argc;
+    }
+    if (!socketPath) {
+        std::cerr << "usage: sudoku --client --socket=<path> < requests\n";
+        return 2;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    int fd;
+    try { fd = connectTo(socketPath); }
+    catch (const std::exception& e) {
+        std::cerr << "sudoku: " << e.what() << "\n";
+        return 1;
+    }
+
+    // requests go out while replies come back
+    std::thread sender([fd] {
+        char buffer[1 << 16];
+        ssize_t n;
+        while ((n = read(0, buffer, sizeof buffer)) != 0) {
+            if (n < 0 && errno == EINTR) continue;
+            if (n < 0 || !writeAll(fd, buffer, n)) break;
+        }
+        shutdown(fd, SHUT_WR); // the daemon answers what is pending, then closes
+    });
+
+    char buffer[1 << 16];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof buffer)) != 0) {
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 || !writeAll(1, buffer, n)) break;
+    }
+    sender.join();
+    close(fd);
+    return 0;
+}
+
+/* =========================================== */
+/* ============= LOAD GENERATOR ============== */
+/* =========================================== */
+
+static int loadUsage() {
+    std::cerr << "usage: sudoku --load [--socket=<path>] [--requests=N] [--concurrency=N] [--command=<name>]\n"
+                 "                    [--size=N] [--difficulty=N] [--seed=N] [--threads[=N]]\n"
+                 "       commands: solve, count, unique, generate, verify\n";
+    return 2;
+}
+
+int runLoad(int argc, char* argv[]) {
+    const char* socketPath = nullptr;
+    long numRequests = 10000, concurrency = 64;
+    int size = 9, difficulty = 4, threads = 0;
+    uint64_t seed = 1;
+    std::string command = "solve";
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--socket=", 0) == 0) socketPath = argv[i] + 9;
+        else if (arg.rfind("--requests=", 0) == 0) numRequests = std::max(1L, std::atol(arg.c_str() + 11));
+        else if (arg.rfind("--concurrency=", 0) == 0) concurrency = std::max(1L, std::atol(arg.c_str() + 14));
+        else if (arg.rfind("--command=", 0) == 0) command = arg.substr(10);
+        else if (arg.rfind("--size=", 0) == 0) size = std::atoi(arg.c_str() + 7);
+        else if (arg.rfind("--difficulty=", 0) == 0) difficulty = std::atoi(arg.c_str() + 13);
+        else if (arg.rfind("--seed=", 0) == 0) seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        else if (arg == "--threads") threads = 0;
+        else if (arg.rfind("--threads=", 0) == 0) threads = std::max(0, std::atoi(arg.c_str() + 10));
+        else return loadUsage();
+    }
+    if (command != "solve" && command != "count" && command != "unique" && command != "generate" && command != "verify")
+        return loadUsage();
+    signal(SIGPIPE, SIG_IGN);
+
+    std::chrono::steady_clock sc;
+    try {
+        // request texts after the id, cycling through a few puzzles
+        std::vector<std::string> requests;
+        std::vector<char> line(2 * maxLineLength(size) + 1);
+        for (long k = 0; k < std::min(numRequests, 100L); k++) {
+            if (command == "generate") { requests.push_back("generate " + std::to_string(size) + " " + std::to_string(difficulty)); break; }
+            Random random(seed + k);
+            Sudoku puzzle(difficulty, size, random);
+            std::string text(line.data(), formatPuzzle(puzzle, line.data()));
+            if (command == "verify") {
+                Sudoku solution(puzzle);
+                SudokuSolver::solve(solution);
+                text += " " + std::string(line.data(), formatPuzzle(solution, line.data()));
+            }
+            requests.push_back((command == "count" ? "count 2" : command) + " " + text);
+        }
+
+        // a daemon of our own on the other end of a socket pair, unless one is given
+        std::unique_ptr<SolverDaemon> daemon;
+        std::thread server;
+        int fd;
+        if (socketPath) fd = connectTo(socketPath);
+        else {
+            DaemonOptions options;
+            options.threads = threads;
+            daemon.reset(new SolverDaemon(options));
+            int fds[2];
+            if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) throw std::runtime_error("Cannot create a socket pair");
+            fd = fds[0];
+            server = std::thread([&daemon, fds] { daemon->serve(fds[1], fds[1]); close(fds[1]); });
+        }
+
+        std::mutex mutex;
+        std::condition_variable room;       // replies came back, more requests may go out
+        long outstanding = 0, received = 0, errors = 0;
+        std::vector<std::chrono::steady_clock::time_point> sent(numRequests);
+        std::vector<double> latencies;      // microseconds
+        latencies.reserve(numRequests);
+        auto start = sc.now();
+
+        // sends whatever the window allows in one write, so requests arrive together like from a busy client
+        std::thread sender([&] {
+            std::string lines;
+            for (long i = 0; i < numRequests; ) {
+                long n;
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    room.wait(lock, [&] { return outstanding < concurrency; });
+                    n = std::min(concurrency - outstanding, numRequests - i);
+                    outstanding += n;
+                }
+                lines.clear();
+                for (long k = i; k < i + n; k++) lines += std::to_string(k) + " " + requests[k % requests.size()] + "\n";
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    auto now = sc.now();
+                    for (long k = i; k < i + n; k++) sent[k] = now;
+                }
+                i += n;
+                if (!writeAll(fd, lines.data(), lines.size())) break;
+            }
+            shutdown(fd, SHUT_WR);
+        });
+
+        std::vector<char> buffer(1 << 16);
+        size_t used = 0;
+        while (received < numRequests) {
+            ssize_t n = read(fd, buffer.data() + used, buffer.size() - used);
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) break;
+
+            auto now = sc.now();
+            size_t begin = 0, end = used + n;
+            const char* newline;
+            std::lock_guard<std::mutex> lock(mutex);
+            while ((newline = static_cast<const char*>(std::memchr(buffer.data() + begin, '\n', end - begin)))) {
+                char* after;
+                long id = std::strtol(buffer.data() + begin, &after, 10);
+                if (id >= 0 && id < numRequests)
+                    latencies.push_back(std::chrono::duration<double, std::micro>(now - sent[id]).count());
+                if (std::strncmp(after, " error", 6) == 0) errors++;
+                received++;
+                outstanding--;
+                begin = newline - buffer.data() + 1;
+            }
+            room.notify_all();
+
+            used = end - begin;
+            std::memmove(buffer.data(), buffer.data() + begin, used);
+            if (used == buffer.size()) buffer.resize(2 * buffer.size());
+        }
+        double seconds = static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+        sender.join();
+        if (server.joinable()) server.join();
+        close(fd);
+
+        std::sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) {
+            return latencies.empty() ? 0 : latencies[std::min(latencies.size() - 1, (size_t) (p * latencies.size()))];
+        };
+        double mean = 0;
+        for (double latency : latencies) mean += latency;
+        std::cout << received << " " << command << " requests in " << seconds << " s (" << (seconds > 0 ? received / seconds : 0)
+                  << " requests/s), " << concurrency << " in flight, " << errors << " errors\n";
+        std::cout << "latency (us): mean " << (latencies.empty() ? 0 : mean / latencies.size()) << ", p50 " << percentile(0.5)
+                  << ", p90 " << percentile(0.9) << ", p99 " << percentile(0.99) << ", max " << percentile(1) << "\n";
+        if (daemon) {
+            SolverDaemon::Stats stats = daemon->stats();
+            std::cout << "daemon: " << stats.batches << " batches, " << (stats.batches ? (double) stats.requests / stats.batches : 0)
+                      << " requests per batch\n";
+        }
+        if (received < numRequests) {
+            std::cerr << "sudoku: connection closed after " << received << " replies\n";
+            return 1;
+        }
+    }
+    catch (const std::exception& e) {
+        std::cerr << "sudoku: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
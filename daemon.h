@@ -0,0 +1,96 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <vector>
+
+#include "sudoku.h"
+#include "threadpool.h"
+
+/* =========================================== */
+/* ================= DAEMON ================== */
+/* =========================================== */
+
+/* Long-running solver answering requests over a Unix domain socket, or over stdin/stdout.
+   A request is a line "<id> <command> <arguments>", id being any word chosen by the client, and gets one line back:
+     <id> solve <puzzle>                        ->  <id> <solution>, or <id> none
+     <id> count <limit> <puzzle>                ->  <id> <number of solutions, up to limit>
+     <id> unique <puzzle>                       ->  <id> unique, multiple or unsolvable
+     <id> generate <size> <difficulty> [seed]   ->  <id> <puzzle>
+     <id> verify [<puzzle>] <solution>          ->  <id> valid or invalid
+   Puzzles are written without blanks (see puzzleio.h). A search out of node budget answers "<id> gave-up",
+   a request that cannot be answered "<id> error <reason>".
+   The requests of a connection that arrive together are split into micro-batches, solved on a thread pool
+   where each worker keeps its boards and buffers warm. Each batch is answered as soon as it is done,
+   so the replies come in the order the batches finish, not in request order. Replies are written by a thread
+   of each connection: a client that reads slowly only slows its own requests down */
+
+struct DaemonOptions {
+    int threads = 0;                    // pool workers, 0 for one per core
+    int batchSize = 32;                 // most requests in one micro-batch
+    SudokuSolver::Options solver;
+};
+
+class SolverDaemon {
+public:
+    struct Stats {
+        long requests = 0;
+        long batches = 0;
+        long errors = 0;                // requests answered with an error
+        long connections = 0;
+    };
+
+private:
+    struct Worker;
+    struct Connection;
+    struct Batch;
+
+    DaemonOptions _options;
+    ThreadPool _pool;
+    std::vector<std::unique_ptr<Worker>> _workers; // one per pool worker
+    std::atomic<long> _requests, _batches, _errors, _connections;
+    std::atomic<bool> _stopping;
+
+    std::mutex _mutex;
+    std::condition_variable _closed;    // a connection of listen ended
+    std::set<int> _open;                // sockets of the connections being served by listen
+
+public:
+    explicit SolverDaemon(const DaemonOptions& options = DaemonOptions());
+
+    ~SolverDaemon();
+
+    /* Answers the requests read from inFd on outFd, until the input ends and every reply is written */
+    void serve(int inFd, int outFd);
+
+    /* Accepts connections on a Unix domain socket at path, serving each on its own thread, until stop().
+       Throws std::runtime_error if the socket cannot be created */
+    void listen(const char* path);
+
+    /* Makes listen stop accepting, end its connections after their pending replies and return.
+       Safe to call from a signal handler */
+    void stop() { _stopping = true; }
+
+    Stats stats() const;
+
+private:
+    void submit(Connection& connection, std::shared_ptr<Batch> batch);
+};
+
+/* Entry point of "sudoku --daemon [--socket=<path>] [--threads[=N]] [--batch=N] [--dlx] [--budget=N]",
+   which serves stdin/stdout without a socket. Returns the process exit code */
+int runDaemon(int argc, char* argv[]);
+
+/* Entry point of "sudoku --client --socket=<path>": sends the request lines of stdin, prints the replies */
+int runClient(int argc, char* argv[]);
+
+/* Entry point of "sudoku --load [--socket=<path>] [--requests=N] [--concurrency=N] [--command=<name>]
+   [--size=N] [--difficulty=N] [--seed=N] [--threads[=N]]": keeps concurrency requests in flight and reports
+   the throughput and latency percentiles. Without a socket it starts a daemon of its own */
+int runLoad(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,226 @@
+#include "dlx.h"
+
+/* =========================================== */
+/* ============ DANCING LINKS SOLVER ========= */
+/* =========================================== */
+
+DlxSolver::DlxSolver(int size) : _size(0) { build(size); }
+
+/* Builds the full exact cover matrix of a board size: 4*size^2 columns, size^3 rows of 4 nodes */
+void DlxSolver::build(int size) {
+    int boxSize = (int) sqrt(size);
+    int numCells = size*size;
+    _size = size;
+    _numColumns = 4 * numCells;
+    _firstRowNode = _numColumns + 1;
+    int numNodes = _firstRowNode + 4 * numCells * size;
+
+    _left.resize(numNodes); _right.resize(numNodes);
+    _up.resize(numNodes); _down.resize(numNodes);
+    _column.resize(numNodes);
+    _columnSize.assign(_numColumns + 1, 0);
+    _choice.resize(numCells);
+    _firstSolution.reserve(numCells);
+    _clueRows.reserve(numCells);
+
+    // root and column headers form a circular list
+    for (int c = 0; c <= _numColumns; c++) {
+        _left[c] = c == 0 ? _numColumns : c - 1;
+        _right[c] = c == _numColumns ? 0 : c + 1;
+        _up[c] = _down[c] = _column[c] = c;
+    }
+
+    // one row per (cell, digit), its nodes appended at the bottom of their columns
+    for (int cell = 0; cell < numCells; cell++) {
+        int x = cell % size, y = cell / size, box = (y / boxSize) * boxSize + x / boxSize;
+        for (int digit = 0; digit < size; digit++) {
+            int base = _firstRowNode + 4 * (cell*size + digit);
+            int columns[4] = { 1 + cell,                           // cell is filled
+                               1 + numCells + y*size + digit,      // row has the digit
+                               1 + 2*numCells + x*size + digit,    // column has the digit
+                               1 + 3*numCells + box*size + digit };// box has the digit
+            for (int k = 0; k < 4; k++) {
+                int node = base + k, column = columns[k];
+                _left[node] = base + (k + 3) % 4;
+                _right[node] = base + (k + 1) % 4;
+                _column[node] = column;
+                _up[node] = _up[column];
+                _down[node] = column;
+                _down[_up[column]] = node;
+                _up[column] = node;
+                _columnSize[column]++;
+            }
+        }
+    }
+}
+
+/* Removes a column and every row that intersects it */
+void DlxSolver::cover(int column) {
+    _right[_left[column]] = _right[column];
+    _left[_right[column]] = _left[column];
+    for (int i = _down[column]; i != column; i = _down[i])
+        for (int j = _right[i]; j != i; j = _right[j]) {
+            _down[_up[j]] = _down[j];
+            _up[_down[j]] = _up[j];
+            _columnSize[_column[j]]--;
+        }
+}
+
+/* Exact inverse of cover */
+void DlxSolver::uncover(int column) {
+    for (int i = _up[column]; i != column; i = _up[i])
+        for (int j = _left[i]; j != i; j = _left[j]) {
+            _columnSize[_column[j]]++;
+            _down[_up[j]] = j;
+            _up[_down[j]] = j;
+        }
+    _right[_left[column]] = column;
+    _left[_right[column]] = column;
+}
+
+/* Puts a row in the cover: removes all of its columns */
+void DlxSolver::selectRow(int node) {
+    cover(_column[node]);
+    for (int j = _right[node]; j != node; j = _right[j]) cover(_column[j]);
+}
+
+void DlxSolver::unselectRow(int node) {
+    for (int j = _left[node]; j != node; j = _left[j]) uncover(_column[j]);
+    uncover(_column[node]);
+}
+
+/* Takes a row out of its columns, so the search never picks it */
+void DlxSolver::hideRow(int node) {
+    int j = node;
+    do {
+        _down[_up[j]] = _down[j];
+        _up[_down[j]] = _up[j];
+        _columnSize[_column[j]]--;
+        j = _right[j];
+    } while (j != node);
+}
+
+void DlxSolver::unhideRow(int node) {
+    int j = _left[node];
+    do {
+        _columnSize[_column[j]]++;
+        _down[_up[j]] = j;
+        _up[_down[j]] = j;
+        j = _left[j];
+    } while (j != _left[node]);
+}
+
+/* Selects the rows of the filled cells, false if two of them conflict */
+bool DlxSolver::coverClues(const Sudoku& puzzle) {
+    _clueRows.clear();
+    for (int i = 0; i < puzzle.getNumCells(); i++) {
+        int value = puzzle.valueAt(i);
+        if (value == 0) continue;
+        int node = _firstRowNode + 4 * (i*_size + value - 1);
+
+        // a column already gone means an earlier clue covers the same constraint
+        int j = node;
+        do {
+            if (_right[_left[_column[j]]] != _column[j]) { uncoverClues(); return false; }
+            j = _right[j];
+        } while (j != node);
+
+        selectRow(node);
+        _clueRows.push_back(node);
+    }
+    return true;
+}
+
+void DlxSolver::uncoverClues() {
+    while (!_clueRows.empty()) {
+        unselectRow(_clueRows.back());
+        _clueRows.pop_back();
+    }
+}
+
+/* Writes the rows of the first solution into the board */
+void DlxSolver::writeSolution(Sudoku& solution) const {
+    for (int node : _firstSolution) {
+        int row = rowOf(node);
+        solution.setValueAt(row / _size, row % _size + 1);
+    }
+}
+
+/* Algorithm X with an explicit stack of chosen rows, always branching on the column with the fewest rows.
+   The matrix is back to its original state when it returns */
+int DlxSolver::search(const Sudoku& puzzle, int limit, Sudoku* solution, const SudokuSolver::Options& options) {
+    if (puzzle.getSize() != _size) build(puzzle.getSize());
+    if (!coverClues(puzzle)) return 0;
+
+    SudokuSolver::SolverStats stats;
+    stats.searches++;
+    int found = 0, depth = 0;
+    bool descend = true;
+    while (true) {
+        if (options.cancelled()) break;
+        int node;
+        if (descend) {
+            if (++stats.nodes > options.nodeBudget && options.nodeBudget) {
+                stats.outOfBudget++;
+                break;
+            }
+            if (_right[0] == 0) { // every constraint satisfied -> found a solution
+                if (++found == 1) _firstSolution.assign(_choice.begin(), _choice.begin() + depth);
+                if (found >= limit) break;
+                descend = false;
+                continue;
+            }
+            int best = _right[0];
+            for (int c = _right[best]; c != 0 && _columnSize[best] > 1; c = _right[c])
+                if (_columnSize[c] < _columnSize[best]) best = c;
+            cover(best);
+            node = _choice[depth] = _down[best];
+        }
+        else { // backtrack: undo the row of the level above and move to its next row
+            if (depth == 0) break;
+            depth--;
+            for (int j = _left[_choice[depth]]; j != _choice[depth]; j = _left[j]) uncover(_column[j]);
+            node = _choice[depth] = _down[_choice[depth]];
+        }
+
+        if (node == _column[node]) { // no rows left in this column
+            SUDOKU_STAT(stats.backtracks++);
+            uncover(node);
+            descend = false;
+            continue;
+        }
+        SUDOKU_STAT(stats.candidatesTried++);
+        for (int j = _right[node]; j != node; j = _right[j]) cover(_column[j]);
+        depth++;
+        SUDOKU_STAT(stats.maxDepth = std::max(stats.maxDepth, depth));
+        descend = true;
+    }
+
+    // stopped at the limit (or cancelled, or out of budget) -> unwind the remaining levels
+    while (depth > 0) unselectRow(_choice[--depth]);
+    uncoverClues();
+    if (options.stats) *options.stats += stats;
+    if (stats.outOfBudget) return SudokuSolver::gaveUp;
+    if (solution && found > 0) writeSolution(*solution);
+    return found;
+}
+
+int DlxSolver::countSolutions(Sudoku& puzzle, int limit, const SudokuSolver::Options& options) {
+    return search(puzzle, limit, &puzzle, options);
+}
+
+bool DlxSolver::solve(Sudoku& puzzle, const SudokuSolver::Options& options) {
+    for (int i = 0; i < puzzle.getNumCells(); i++) puzzle.setValueAt(i, 0);
+    return search(puzzle, 1, &puzzle, options) == 1;
+}
+
+bool DlxSolver::isUnique(const Sudoku& puzzle, const SudokuSolver::Options& options) { return search(puzzle, 2, nullptr, options) == 1; }
+
+bool DlxSolver::hasSolutionWithout(const Sudoku& puzzle, int cell, int value, const SudokuSolver::Options& options) {
+    if (puzzle.getSize() != _size) build(puzzle.getSize());
+    int node = _firstRowNode + 4 * (cell*_size + value - 1);
+    hideRow(node);
+    bool found = search(puzzle, 1, nullptr, options) != 0;
+    unhideRow(node);
+    return found;
+}
@@ -0,0 +1,69 @@
+#ifndef DLX_H
+#define DLX_H
+
+#include <vector>
+#include <atomic>
+
+#include "sudoku.h"
+
+/* =========================================== */
+/* ============ DANCING LINKS SOLVER ========= */
+/* =========================================== */
+
+/* Solves sudokus as an exact cover problem (Algorithm X on dancing links).
+   Columns are the constraints: each cell holds one digit, each row, column and box holds each digit once.
+   Rows are the (cell, digit) placements. The matrix of a board size is built once and every puzzle
+   only covers its clues, so the same solver is reused between puzzles without allocating */
+class DlxSolver {
+    int _size;                  // board size the matrix was built for
+    int _numColumns;
+    int _firstRowNode;          // nodes 0.._numColumns are the root and the column headers
+
+    std::vector<int> _left, _right, _up, _down, _column;   // links of every node
+    std::vector<int> _columnSize;                          // nodes left in each column
+    std::vector<int> _choice;                              // chosen node at each search depth
+    std::vector<int> _firstSolution;                       // chosen nodes of the first solution found
+    std::vector<int> _clueRows;                            // rows covered for the clues of the current puzzle
+
+public:
+    explicit DlxSolver(int size = 9);
+
+    /* Number of solutions up to limit. The puzzle is left holding the first solution found,
+       or unchanged if there is none. Of the options, only cancel, stats and nodeBudget apply
+       (see SudokuSolver::countSolutions) */
+    int countSolutions(Sudoku& puzzle, int limit, const SudokuSolver::Options& options = SudokuSolver::Options());
+
+    bool solve(Sudoku& puzzle, const SudokuSolver::Options& options = SudokuSolver::Options());
+
+    bool isUnique(const Sudoku& puzzle, const SudokuSolver::Options& options = SudokuSolver::Options());
+
+    /* True if the puzzle has a solution where the cell at index cell does not hold value (or the search gave up) */
+    bool hasSolutionWithout(const Sudoku& puzzle, int cell, int value, const SudokuSolver::Options& options = SudokuSolver::Options());
+
+private:
+    void build(int size);
+
+    int rowOf(int node) const { return (node - _firstRowNode) / 4; }
+
+    void cover(int column);
+
+    void uncover(int column);
+
+    void selectRow(int node);
+
+    void unselectRow(int node);
+
+    void hideRow(int node);
+
+    void unhideRow(int node);
+
+    bool coverClues(const Sudoku& puzzle);
+
+    void uncoverClues();
+
+    int search(const Sudoku& puzzle, int limit, Sudoku* solution, const SudokuSolver::Options& options);
+
+    void writeSolution(Sudoku& solution) const;
+};
+
+#endif
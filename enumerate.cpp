@@ -0,0 +1,315 @@
+#include "enumerate.h"
+
+#include <csignal>
+#include <cstdio>
+#include <memory>
+#include <stdexcept>
+#include <unistd.h>
+
+#include "parallel.h"
+#include "puzzleio.h"
+
+/* =========================================== */
+/* =========== SOLUTION ENUMERATION ========== */
+/* =========================================== */
+
+static const char* checkpointHeader = "sudoku-enumeration 1";
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+/* Solutions found by one worker, alone on its cache line. Only its worker writes it */
+struct alignas(64) WorkerCount {
+    std::atomic<uint64_t> solutions{0};
+};
+
+/* State shared by the caller and the pool tasks (kept alive by the last of them) */
+struct Enumeration {
+    std::vector<Sudoku> subtrees;       // the frontier
+    std::vector<bool> done;             // per subtree
+    SudokuSolver::Options options;
+    std::function<bool(const Sudoku&, int)> onSolution;
+
+    std::atomic<bool> cancel;
+    std::atomic<size_t> next;           // next subtree to search
+    std::vector<WorkerCount> counts;    // per worker, subtrees still running included
+
+    std::mutex mutex;
+    std::condition_variable allDone;
+    size_t finished = 0;                // subtrees searched (or skipped after cancelling)
+    long subtreesDone = 0;              // of those, the ones searched to the end, and the ones done before a resume
+    uint64_t committed = 0;             // solutions of the subtrees searched to the end, and of those before a resume
+    uint64_t resumedSolutions = 0;
+    SudokuSolver::SolverStats stats;
+
+    Enumeration(const SudokuSolver::EnumerationOptions& settings, int numWorkers)
+        : options(settings.solver), onSolution(settings.onSolution), cancel(false), next(0), counts(numWorkers) {
+        options.cancel = &cancel;
+        options.nodeBudget = 0;
+        options.deductions = nullptr;
+        options.stats = nullptr;
+    }
+
+    uint64_t solutions() const {
+        uint64_t total = resumedSolutions;
+        for (const WorkerCount& count : counts) total += count.solutions.load(std::memory_order_relaxed);
+        return total;
+    }
+
+    void searchSubtrees(int worker);
+};
+
+/* Takes subtrees until none is left. A subtree cut short by cancelling stays in the frontier */
+void Enumeration::searchSubtrees(int worker) {
+    std::atomic<uint64_t>& counter = counts[worker].solutions;
+    SudokuSolver::SolutionVisitor visit = [&](const Sudoku& solution) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        if (onSolution && !onSolution(solution, worker)) {
+            cancel = true;
+            return false;
+        }
+        return true;
+    };
+
+    for (size_t i = next++; i < subtrees.size(); i = next++) {
+        SudokuSolver::SolverStats subtreeStats;
+        SudokuSolver::Options subtreeOptions = options;
+        subtreeOptions.stats = &subtreeStats;
+        Sudoku board(subtrees[i]); // the frontier itself stays as it is, to be saved meanwhile
+        uint64_t found = cancel ? 0 : SudokuSolver::forEachSolution(board, visit, subtreeOptions);
+        bool complete = !cancel; // the flag only goes up: still down, so the search was not stopped
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (complete) {
+            done[i] = true;
+            subtreesDone++;
+            committed += found;
+        }
+        stats += subtreeStats;
+        if (++finished == subtrees.size()) allDone.notify_all();
+    }
+}
+
+/* Puzzle line of the clues alone */
+std::string clueLine(const Sudoku& puzzle) {
+    Sudoku clues(puzzle);
+    for (int i = 0; i < clues.getNumCells(); i++) clues.setValueAt(i, 0);
+    std::string line(maxLineLength(clues.getSize()), ' ');
+    line.resize(formatPuzzle(clues, &line[0]));
+    return line;
+}
+
+/* Writes "<header>\n<clues>\n<solutions> <subtrees done> <subtrees left>\n", then a line per subtree left.
+   Written next to the target and renamed, so a crash while saving keeps the previous checkpoint */
+void saveCheckpoint(const std::string& path, const std::string& clues, uint64_t solutions, long subtreesDone,
+                    const std::vector<Sudoku>& subtrees, const std::vector<bool>& done) {
+    std::string temporary = path + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "w");
+    if (!file) throw std::runtime_error("Cannot write " + temporary);
+    size_t left = std::count(done.begin(), done.end(), false);
+    bool ok = std::fprintf(file, "%s\n%s\n%llu %ld %zu\n", checkpointHeader, clues.c_str(), (unsigned long long) solutions, subtreesDone, left) > 0;
+    std::vector<char> line(maxLineLength(subtrees.empty() ? 1 : subtrees[0].getSize()) + 1);
+    for (size_t i = 0; i < subtrees.size() && ok; i++) {
+        if (done[i]) continue;
+        size_t length = formatPuzzle(subtrees[i], line.data());
+        line[length] = '\n';
+        ok = std::fwrite(line.data(), 1, length + 1, file) == length + 1;
+    }
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Cannot write " + path);
+    }
+}
+
+/* Reads the frontier saved for the same clues, false if there is no checkpoint */
+bool loadCheckpoint(const std::string& path, const std::string& clues, Enumeration& enumeration) {
+    if (access(path.c_str(), F_OK) != 0) return false;
+    LineReader reader(path.c_str());
+    const char* line;
+    size_t length;
+    unsigned long long solutions = 0;
+    long subtreesDone = 0;
+    size_t left = 0;
+    if (!reader.next(line, length) || std::string(line, length) != checkpointHeader)
+        throw std::runtime_error(path + " is not an enumeration checkpoint.");
+    if (!reader.next(line, length) || std::string(line, length) != clues)
+        throw std::runtime_error("Checkpoint " + path + " is for another puzzle.");
+    if (!reader.next(line, length) || std::sscanf(std::string(line, length).c_str(), "%llu %ld %zu", &solutions, &subtreesDone, &left) != 3)
+        throw std::runtime_error(path + " is not an enumeration checkpoint.");
+
+    std::vector<Sudoku::Value> values(Sudoku::maxSize * Sudoku::maxSize);
+    while (reader.next(line, length)) {
+        int size = parsePuzzle(line, length, values.data());
+        if (size == 0) throw std::runtime_error(path + " has a line that is not a board.");
+        enumeration.subtrees.push_back(Sudoku(size, values.data()));
+    }
+    if (enumeration.subtrees.size() != left) throw std::runtime_error(path + " is truncated.");
+    enumeration.committed = enumeration.resumedSolutions = solutions;
+    enumeration.subtreesDone = subtreesDone;
+    return true;
+}
+
+}
+
+uint64_t SudokuSolver::enumerateSolutions(const Sudoku& puzzle, ThreadPool& pool, const EnumerationOptions& options,
+                                          EnumerationReport* report) {
+    Clock::time_point start = Clock::now();
+    std::shared_ptr<Enumeration> enumeration = std::make_shared<Enumeration>(options, pool.size());
+    std::string clues = clueLine(puzzle);
+    bool resumed = !options.checkpoint.empty() && loadCheckpoint(options.checkpoint, clues, *enumeration);
+    if (!resumed) {
+        Sudoku root(puzzle);
+        for (int i = 0; i < root.getNumCells(); i++) root.setValueAt(i, 0);
+        if (!root.hasConflicts()) enumeration->subtrees.push_back(root);
+        splitSearch(enumeration->subtrees, std::max(1, options.subtreesPerThread) * pool.size());
+    }
+    enumeration->done.assign(enumeration->subtrees.size(), false);
+    long totalSubtrees = enumeration->subtreesDone + enumeration->subtrees.size();
+
+    for (int w = 0; w < pool.size(); w++)
+        pool.submit([enumeration](int worker) { enumeration->searchSubtrees(worker); });
+
+    // however this returns, a failed checkpoint or progress callback included, the workers are done first
+    struct StopWorkers {
+        Enumeration& enumeration;
+        ~StopWorkers() {
+            enumeration.cancel = true;
+            std::unique_lock<std::mutex> lock(enumeration.mutex);
+            enumeration.allDone.wait(lock, [&] { return enumeration.finished == enumeration.subtrees.size(); });
+        }
+    } stopWorkers{*enumeration};
+
+    // progress and checkpoints from this thread, while the workers search
+    long checkpoints = 0;
+    auto progress = [&](Clock::time_point now, long subtreesDone) {
+        EnumerationProgress state;
+        state.subtrees = totalSubtrees;
+        state.subtreesDone = subtreesDone;
+        state.solutions = enumeration->solutions();
+        state.seconds = std::chrono::duration<double>(now - start).count();
+        state.solutionsPerSecond = state.seconds > 0 ? (state.solutions - enumeration->resumedSolutions) / state.seconds : 0;
+        options.onProgress(state);
+    };
+    auto save = [&](std::unique_lock<std::mutex>& lock) {
+        std::vector<bool> done = enumeration->done;
+        uint64_t committed = enumeration->committed;
+        long subtreesDone = enumeration->subtreesDone;
+        lock.unlock(); // the subtrees themselves are only read by the workers
+        saveCheckpoint(options.checkpoint, clues, committed, subtreesDone, enumeration->subtrees, done);
+        checkpoints++;
+        lock.lock();
+    };
+    auto seconds = [](double s) { return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(s)); };
+    Clock::time_point nextProgress = start + seconds(options.progressSeconds);
+    Clock::time_point nextCheckpoint = start + seconds(options.checkpointSeconds);
+
+    std::unique_lock<std::mutex> lock(enumeration->mutex);
+    while (enumeration->finished < enumeration->subtrees.size()) {
+        enumeration->allDone.wait_for(lock, std::chrono::milliseconds(50));
+        if (options.solver.cancel && options.solver.cancel->load()) enumeration->cancel = true;
+        Clock::time_point now = Clock::now();
+        if (options.onProgress && options.progressSeconds > 0 && now >= nextProgress) {
+            long subtreesDone = enumeration->subtreesDone;
+            lock.unlock();
+            progress(now, subtreesDone);
+            lock.lock();
+            nextProgress = now + seconds(options.progressSeconds);
+        }
+        if (!options.checkpoint.empty() && now >= nextCheckpoint) {
+            save(lock);
+            nextCheckpoint = Clock::now() + seconds(options.checkpointSeconds);
+        }
+    }
+    if (!options.checkpoint.empty()) save(lock);
+    if (options.onProgress) progress(Clock::now(), enumeration->subtreesDone);
+
+    uint64_t solutions = enumeration->solutions();
+    if (report) {
+        report->solutions = solutions;
+        report->complete = enumeration->subtreesDone == totalSubtrees;
+        report->resumed = resumed;
+        report->subtrees = totalSubtrees;
+        report->checkpoints = checkpoints;
+        report->seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        report->stats = enumeration->stats;
+    }
+    if (options.solver.stats) *options.solver.stats += enumeration->stats;
+    return solutions;
+}
+
+/* =========================================== */
+/* ================= COMMAND ================= */
+/* =========================================== */
+
+static std::atomic<bool> interrupted(false);
+
+static void interruptEnumeration(int) {
+    interrupted = true;
+}
+
+static int enumerateUsage() {
+    std::cerr << "usage: sudoku --enumerate [--threads=N] [--checkpoint=<file>] [--progress=seconds] [--print] [puzzle]\n";
+    return 2;
+}
+
+int runEnumerate(int argc, char* argv[]) {
+    SudokuSolver::EnumerationOptions options;
+    int threads = 0;
+    bool print = false;
+    std::string line;
+    for (int i = 0; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--threads=", 0) == 0) threads = std::max(0, std::atoi(arg.c_str() + 10));
+        else if (arg.rfind("--checkpoint=", 0) == 0) options.checkpoint = arg.substr(13);
+        else if (arg.rfind("--progress=", 0) == 0) options.progressSeconds = std::atof(arg.c_str() + 11);
+        else if (arg == "--print") print = true;
+        else if (arg.rfind("--", 0) != 0 && line.empty()) line = arg;
+        else return enumerateUsage();
+    }
+
+    try {
+        if (line.empty()) { // first line of stdin
+            LineReader reader;
+            const char* text;
+            size_t length;
+            if (reader.next(text, length)) line.assign(text, length);
+        }
+        std::vector<Sudoku::Value> values(Sudoku::maxSize * Sudoku::maxSize);
+        int size = parsePuzzle(line.data(), line.size(), values.data());
+        if (size == 0) throw std::invalid_argument("Not a puzzle: " + line);
+        Sudoku puzzle(size, values.data());
+
+        std::mutex printMutex;
+        std::vector<char> solutionLine(maxLineLength(size) + 1);
+        if (print) options.onSolution = [&](const Sudoku& solution, int) {
+            std::lock_guard<std::mutex> lock(printMutex);
+            size_t length = formatPuzzle(solution, solutionLine.data());
+            solutionLine[length] = '\n';
+            std::fwrite(solutionLine.data(), 1, length + 1, stdout);
+            return true;
+        };
+        options.onProgress = [](const SudokuSolver::EnumerationProgress& progress) {
+            std::cerr << "\r" << progress.solutions << " solutions, " << progress.subtreesDone << "/" << progress.subtrees
+                      << " subtrees, " << (long) progress.solutionsPerSecond << " per second    " << std::flush;
+        };
+        options.solver.cancel = &interrupted;
+        signal(SIGINT, interruptEnumeration);
+        signal(SIGTERM, interruptEnumeration);
+
+        ThreadPool pool(threads);
+        SudokuSolver::EnumerationReport report;
+        uint64_t solutions = SudokuSolver::enumerateSolutions(puzzle, pool, options, &report);
+        std::fflush(stdout);
+        std::cerr << "\n" << solutions << " solutions" << (report.complete ? "" : " so far (stopped)") << " in " << report.seconds
+                  << " s on " << pool.size() << " threads, " << report.stats.nodes << " nodes"
+                  << (report.resumed ? ", resumed from " + options.checkpoint : "") << "\n";
+        if (!print) std::cout << solutions << "\n";
+        return report.complete ? 0 : 1;
+    }
+    catch (const std::exception& e) {
+        std::cerr << "sudoku: " << e.what() << "\n";
+        return 1;
+    }
+}
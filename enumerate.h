@@ -0,0 +1,63 @@
+#ifndef ENUMERATE_H
+#define ENUMERATE_H
+
+#include <string>
+
+#include "sudoku.h"
+#include "threadpool.h"
+
+/* =========================================== */
+/* =========== SOLUTION ENUMERATION ========== */
+/* =========================================== */
+
+/* Visits or counts every solution of boards with few clues, where there are millions to billions of them.
+   The search tree is split at its top branching levels into subtrees, searched on a thread pool with a
+   counter per worker. The subtrees not finished yet are the frontier: it can be saved to a checkpoint file
+   now and then, and a later run on the same puzzle resumes from it */
+
+namespace SudokuSolver {
+    /* Where an enumeration stands */
+    struct EnumerationProgress {
+        uint64_t solutions = 0;         // found so far, in finished and running subtrees
+        long subtreesDone = 0;
+        long subtrees = 0;              // in the whole frontier, the ones done by a resumed run included
+        double seconds = 0;             // of this run
+        double solutionsPerSecond = 0;  // of this run
+    };
+
+    struct EnumerationOptions {
+        Options solver;                 // cell order and deductions; cancel stops the enumeration, the node budget is ignored
+        /* Called for each solution with the index of the worker that found it: calls from different workers
+           run concurrently. Returning false stops the enumeration. nullptr to only count */
+        std::function<bool(const Sudoku& solution, int worker)> onSolution;
+        /* Called from the calling thread every progressSeconds, and once at the end */
+        std::function<void(const EnumerationProgress& progress)> onProgress;
+        double progressSeconds = 1;
+        int subtreesPerThread = 64;     // more subtrees balance the workers better and lose less work on a restart
+        std::string checkpoint;         // file of the frontier, resumed from if it exists; empty for none
+        double checkpointSeconds = 60;  // between two saves, also saved at the end
+    };
+
+    struct EnumerationReport {
+        uint64_t solutions = 0;         // all of them if complete, including those counted before a resume
+        bool complete = false;          // not stopped by cancel or onSolution
+        bool resumed = false;           // started from a checkpoint
+        long subtrees = 0;
+        long checkpoints = 0;           // saves made by this run
+        double seconds = 0;
+        SolverStats stats;
+    };
+
+    /* Enumerates the solutions of the puzzle (its draft values are ignored) on the pool, the calling thread
+       reporting progress and saving checkpoints meanwhile, so it must not be a pool worker.
+       Solutions of the subtrees that were running when a checkpoint was saved are visited again after
+       a resume. Throws std::runtime_error if the checkpoint cannot be written, or belongs to another puzzle */
+    uint64_t enumerateSolutions(const Sudoku& puzzle, ThreadPool& pool, const EnumerationOptions& options = EnumerationOptions(),
+                                EnumerationReport* report = nullptr);
+}
+
+/* Entry point of "sudoku --enumerate [--threads=N] [--checkpoint=<file>] [--progress=seconds] [--print] [puzzle]":
+   counts the solutions of a puzzle line (read from stdin without one), optionally printing each. Returns the process exit code */
+int runEnumerate(int argc, char* argv[]);
+
+#endif
@@ -0,0 +1,40 @@
+#include "fixedsize.h"
+
+#include <climits>
+
+/* =========================================== */
+/* ========= COMPILE-TIME BOARD SIZES ======== */
+/* =========================================== */
+
+bool FixedSize::supports(int size) {
+    return size == 4 || size == 9 || size == 16 || size == 25;
+}
+
+/* A search out of node budget counts as gaveUp here, as in SudokuSolver::countSolutions */
+template <int Box>
+static int countWith(const Sudoku& puzzle, int limit, const SudokuSolver::Options& options, Sudoku* solution) {
+    FixedSize::Search<Box> search(options);
+    long long found = search.count(puzzle, limit, solution);
+    return search.gaveUp() ? SudokuSolver::gaveUp : (int) found;
+}
+
+int FixedSize::countSolutions(const Sudoku& puzzle, int limit, const SudokuSolver::Options& options, Sudoku* solution) {
+    switch (puzzle.getBoxSize()) {
+        case 2: return countWith<2>(puzzle, limit, options, solution);
+        case 3: return countWith<3>(puzzle, limit, options, solution);
+        case 4: return countWith<4>(puzzle, limit, options, solution);
+        case 5: return countWith<5>(puzzle, limit, options, solution);
+        default: return unsupported;
+    }
+}
+
+long long FixedSize::forEachSolution(Sudoku& puzzle, const SudokuSolver::SolutionVisitor* visit, const SudokuSolver::Options& options) {
+    const long long all = LLONG_MAX;
+    switch (puzzle.getBoxSize()) {
+        case 2: return Search<2>(options).count(puzzle, all, nullptr, visit, &puzzle);
+        case 3: return Search<3>(options).count(puzzle, all, nullptr, visit, &puzzle);
+        case 4: return Search<4>(options).count(puzzle, all, nullptr, visit, &puzzle);
+        case 5: return Search<5>(options).count(puzzle, all, nullptr, visit, &puzzle);
+        default: return unsupported;
+    }
+}
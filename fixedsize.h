@@ -0,0 +1,395 @@
+#ifndef FIXEDSIZE_H
+#define FIXEDSIZE_H
+
+#include <cstdint>
+#include <atomic>
+#include <vector>
+#include <type_traits>
+
+#include "sudoku.h"
+
+/* =========================================== */
+/* ========= COMPILE-TIME BOARD SIZES ======== */
+/* =========================================== */
+
+/* The backtracking search of solver.cpp for a box size known at compile time. 4x4, 9x9, 16x16 and 25x25
+   boards get their own instantiation: unit tables are built by the compiler, masks are only as wide as
+   the digits need and every unit scan has a constant length. Each branching level keeps a whole copy of
+   the board state, so backtracking only moves down the stack instead of undoing a trail */
+namespace FixedSize {
+
+/* True if the board size has an instantiation */
+bool supports(int size);
+
+/* countSolutions result for a board size without instantiation */
+const int unsupported = -2;
+
+/* Same contract as SudokuSolver::countSolutions, with the first solution written to solution
+   (when not nullptr; it may be the puzzle itself). The puzzle must not have conflicts.
+   Returns unsupported if the board size has no instantiation */
+int countSolutions(const Sudoku& puzzle, int limit, const SudokuSolver::Options& options, Sudoku* solution);
+
+/* Same contract as SudokuSolver::forEachSolution, without visitor to only count. The board is written for each
+   solution only when there is a visitor. Returns unsupported if the board size has no instantiation */
+long long forEachSolution(Sudoku& puzzle, const SudokuSolver::SolutionVisitor* visit, const SudokuSolver::Options& options);
+
+/* Smallest unsigned type with a bit for every digit 1..size */
+template <int Size>
+using MaskOf = typename std::conditional<(Size < 16), uint16_t,
+               typename std::conditional<(Size < 32), uint32_t, uint64_t>::type>::type;
+
+/* Row, column and box of every cell and the cells of every unit: rows, then columns, then boxes */
+template <int Box>
+struct Tables {
+    static constexpr int size = Box*Box;
+    static constexpr int numCells = size*size;
+
+    uint8_t row[numCells], column[numCells], box[numCells];
+    uint16_t units[3*size][size];
+
+    constexpr Tables() : row(), column(), box(), units() {
+        for (int i = 0; i < numCells; i++) {
+            int y = i / size, x = i % size, b = (y / Box) * Box + x / Box;
+            row[i] = y;
+            column[i] = x;
+            box[i] = b;
+            units[y][x] = i;
+            units[size + x][y] = i;
+            units[2*size + b][(y % Box) * Box + x % Box] = i;
+        }
+    }
+};
+
+template <int Box>
+inline constexpr Tables<Box> tables{};
+
+/* Number of digits in every mask of 9x9 candidates */
+struct PopTable {
+    uint8_t count[1 << 10];
+
+    constexpr PopTable() : count() {
+        for (int mask = 1; mask < (1 << 10); mask++) count[mask] = count[mask >> 1] + (mask & 1);
+    }
+};
+
+inline constexpr PopTable popTable{};
+
+template <int Box>
+class Search {
+    static constexpr int size = Box*Box;
+    static constexpr int numCells = size*size;
+    typedef MaskOf<size> Mask;
+    static constexpr Mask allDigits = Mask(((uint64_t(1) << size) - 1) << 1);
+    static constexpr const Tables<Box>& cells = tables<Box>;
+    static constexpr bool lockedCandidatesPay = Box > 3; // on 4x4 and 9x9 only with Options::lockedCandidates
+
+    /* Board at one branching level */
+    struct State {
+        Mask used[3*size];          // digits placed in each unit
+        Mask excluded[numCells];    // candidates removed by deductions
+        uint8_t values[numCells];
+        int empty;                  // cells left to fill
+    };
+
+    /* A cell being branched on */
+    struct Frame {
+        int cell;
+        Mask remaining;             // candidates not tried yet
+    };
+
+    /* Buffers of a search, kept per thread */
+    struct Workspace {
+        bool busy = false;          // taken by a search running on this thread
+        std::vector<State> states;  // one state per branching level, at most one per empty cell
+        std::vector<Frame> stack;
+        uint8_t solution[numCells]; // first solution found
+
+        Workspace() : states(numCells + 1), stack(numCells + 1) {}
+    };
+
+    static Workspace& threadWorkspace() {
+        thread_local Workspace workspace;
+        return workspace;
+    }
+
+    const SudokuSolver::Options& _options;
+    Workspace* _ownWorkspace;       // only used when a search on this thread already holds the thread's one
+    Workspace& _work;
+    SudokuSolver::Deductions _deductions;
+    SudokuSolver::SolverStats _stats;
+
+public:
+    explicit Search(const SudokuSolver::Options& options)
+        : _options(options), _ownWorkspace(threadWorkspace().busy ? new Workspace : nullptr),
+          _work(_ownWorkspace ? *_ownWorkspace : threadWorkspace()), _deductions(), _stats() {
+        _work.busy = true;
+    }
+
+    ~Search() {
+        _work.busy = false;
+        delete _ownWorkspace;
+        if (_options.deductions) *_options.deductions += _deductions;
+        if (_options.stats) *_options.stats += _stats;
+    }
+
+    Search(const Search&) = delete;
+
+    Search& operator=(const Search&) = delete;
+
+    /* Solutions found, those before the node budget ran out if it did (see gaveUp). With a visitor, the board
+       gets each solution before it is visited and its own values back at the end */
+    long long count(const Sudoku& puzzle, long long limit, Sudoku* solution, const SudokuSolver::SolutionVisitor* visit = nullptr, Sudoku* board = nullptr);
+
+    bool gaveUp() const { return _stats.outOfBudget > 0; }
+
+private:
+    static int bits(Mask mask) {
+        if constexpr (size <= 9) return popTable.count[mask];
+        else return popCount(mask);
+    }
+
+    static Mask bit(int value) { return Mask(1) << value; }
+
+    static Mask candidates(const State& state, int i) {
+        if (state.values[i]) return 0;
+        return allDigits & ~(state.used[cells.row[i]] | state.used[size + cells.column[i]]
+                             | state.used[2*size + cells.box[i]] | state.excluded[i]);
+    }
+
+    static void place(State& state, int i, int value) {
+        state.values[i] = value;
+        state.used[cells.row[i]] |= bit(value);
+        state.used[size + cells.column[i]] |= bit(value);
+        state.used[2*size + cells.box[i]] |= bit(value);
+        state.empty--;
+    }
+
+    bool cancelled() const { return _options.cancelled(); }
+
+    int pickValue(Mask remaining) const;
+
+    int chooseCell(const State& state, Mask& cellCandidates) const;
+
+    bool propagate(State& state);
+
+    bool nakedSingles(State& state, bool& changed);
+
+    bool hiddenSingles(State& state, bool& changed);
+
+    void lockedCandidates(State& state, bool& changed);
+
+    void exclude(State& state, int i, Mask digits, bool& changed);
+};
+
+/* Next candidate to try, according to the value order */
+template <int Box>
+int Search<Box>::pickValue(Mask remaining) const {
+    if (_options.valueOrder == SudokuSolver::ValueOrder::descending) return 63 - __builtin_clzll(remaining);
+    if (_options.valueOrder == SudokuSolver::ValueOrder::random) {
+        Random& random = _options.random ? *_options.random : Random::thread();
+        for (int skip = random.uniform(0, bits(remaining) - 1); skip > 0; skip--) remaining &= remaining - 1;
+    }
+    return lowestBit(remaining);
+}
+
+/* Empty cell with the fewest candidates, -1 if the board is full. Stops at the first cell without candidates */
+template <int Box>
+int Search<Box>::chooseCell(const State& state, Mask& cellCandidates) const {
+    int best = -1, bestCount = size + 1;
+    for (int i = 0; i < numCells; i++) {
+        if (state.values[i]) continue;
+        Mask mask = candidates(state, i);
+        int count = bits(mask);
+        if (count < bestCount) {
+            best = i; bestCount = count; cellCandidates = mask;
+            if (count <= 1) break; // cannot do better
+        }
+    }
+    return best;
+}
+
+/* Applies the deduction rules until none of them changes the board, false on a contradiction */
+template <int Box>
+bool Search<Box>::propagate(State& state) {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        if (!nakedSingles(state, changed)) return false;
+        if (changed) continue; // cheap rules first
+        if (!hiddenSingles(state, changed)) return false;
+        if (changed) continue;
+        if (lockedCandidatesPay || _options.lockedCandidates) lockedCandidates(state, changed);
+    }
+    return true;
+}
+
+/* A cell with a single candidate takes it */
+template <int Box>
+bool Search<Box>::nakedSingles(State& state, bool& changed) {
+    for (int i = 0; i < numCells; i++) {
+        if (state.values[i]) continue;
+        Mask mask = candidates(state, i);
+        if (mask == 0) return false;
+        if (mask & (mask - 1)) continue;
+        place(state, i, lowestBit(mask));
+        _deductions.nakedSingles++;
+        changed = true;
+    }
+    return true;
+}
+
+/* A digit that fits in only one cell of a unit goes there */
+template <int Box>
+bool Search<Box>::hiddenSingles(State& state, bool& changed) {
+    for (int unit = 0; unit < 3*size; unit++) {
+        const uint16_t* unitCells = cells.units[unit];
+        Mask once = 0, twice = 0;
+#pragma GCC unroll 16
+        for (int k = 0; k < size; k++) {
+            Mask mask = candidates(state, unitCells[k]);
+            twice |= once & mask;
+            once |= mask;
+        }
+        if ((state.used[unit] | once) != allDigits) return false; // some digit fits nowhere
+        for (Mask single = once & ~twice; single; single &= single - 1) {
+            int value = lowestBit(single);
+            int k = 0;
+            while (!(candidates(state, unitCells[k]) & bit(value))) {
+                if (++k == size) return false; // taken away by another single of this unit
+            }
+            place(state, unitCells[k], value);
+            _deductions.hiddenSingles++;
+            changed = true;
+        }
+    }
+    return true;
+}
+
+/* Removes digits from the candidates of a cell */
+template <int Box>
+void Search<Box>::exclude(State& state, int i, Mask digits, bool& changed) {
+    Mask removed = digits & candidates(state, i);
+    if (!removed) return;
+    state.excluded[i] |= removed;
+    _deductions.lockedCandidates += bits(removed);
+    changed = true;
+}
+
+/* Pointing pairs and box-line reduction, as in solver.cpp. Row segment k of a box is its cells
+   k*Box..k*Box+Box-1, column segment k its cells k, k+Box, .. */
+template <int Box>
+void Search<Box>::lockedCandidates(State& state, bool& changed) {
+    for (int box = 0; box < size; box++) {
+        const uint16_t* boxCells = cells.units[2*size + box];
+        for (int line = 0; line < 2; line++) { // rows, then columns
+            Mask segment[Box];
+            for (int k = 0; k < Box; k++) {
+                segment[k] = 0;
+                for (int j = 0; j < Box; j++) segment[k] |= candidates(state, boxCells[line ? j*Box + k : k*Box + j]);
+            }
+            for (int k = 0; k < Box; k++) {
+                Mask others = 0;
+                for (int j = 0; j < Box; j++) if (j != k) others |= segment[j];
+
+                // rest of the line, outside this box
+                int first = boxCells[line ? k : k*Box];
+                const uint16_t* lineCells = cells.units[line ? size + cells.column[first] : cells.row[first]];
+                int boxStart = line ? (box / Box) * Box : (box % Box) * Box;
+                Mask outside = 0;
+                for (int j = 0; j < size; j++)
+                    if (j < boxStart || j >= boxStart + Box) outside |= candidates(state, lineCells[j]);
+
+                Mask pointing = segment[k] & ~others & outside;
+                if (pointing)
+                    for (int j = 0; j < size; j++)
+                        if (j < boxStart || j >= boxStart + Box) exclude(state, lineCells[j], pointing, changed);
+
+                Mask claiming = segment[k] & ~outside & others;
+                if (claiming)
+                    for (int j = 0; j < Box; j++) {
+                        if (j == k) continue;
+                        for (int m = 0; m < Box; m++) exclude(state, boxCells[line ? m*Box + j : j*Box + m], claiming, changed);
+                    }
+            }
+        }
+    }
+}
+
+/* Counts solutions up to limit without recursion. Entering a level copies the state of the level above */
+template <int Box>
+long long Search<Box>::count(const Sudoku& puzzle, long long limit, Sudoku* solution, const SudokuSolver::SolutionVisitor* visit, Sudoku* board) {
+    State* states = _work.states.data();
+    Frame* stack = _work.stack.data();
+
+    State& start = states[0];
+    std::fill(std::begin(start.used), std::end(start.used), 0);
+    std::fill(std::begin(start.excluded), std::end(start.excluded), 0);
+    start.empty = numCells;
+    uint8_t original[numCells]; // values of the board, propagation fills the start state in place
+    for (int i = 0; i < numCells; i++) {
+        start.values[i] = 0;
+        original[i] = puzzle.valueAt(i);
+        if (original[i]) place(start, i, original[i]);
+    }
+
+    long long found = 0;
+    int depth = 0;
+    bool enter = true; // entering a new level, otherwise resuming the deepest frame
+    _stats.searches++;
+    while (!cancelled()) {
+        if (enter) {
+            if (++_stats.nodes > _options.nodeBudget && _options.nodeBudget) {
+                _stats.outOfBudget++;
+                break;
+            }
+            State& state = states[depth];
+            Mask cellCandidates = 0;
+            int cell = -2; // contradiction
+            if (propagate(state)) cell = chooseCell(state, cellCandidates);
+
+            if (cell == -1) { // board full -> found a solution
+                if (++found == 1) std::copy(state.values, state.values + numCells, _work.solution);
+                if (visit) {
+                    for (int i = 0; i < numCells; i++) board->setValueAt(i, state.values[i]);
+                    if (!(*visit)(*board)) break;
+                }
+                if (found >= limit) break;
+            }
+            else if (cell >= 0 && cellCandidates) {
+                if (cellCandidates & (cellCandidates - 1)) _deductions.guesses++;
+                stack[depth] = {cell, cellCandidates};
+                SUDOKU_STAT(_stats.maxDepth = std::max(_stats.maxDepth, depth + 1));
+            }
+            else cell = -2;
+            if (cell < 0) depth--; // nothing to branch on here
+        }
+        if (depth < 0) break;
+
+        // copy the state of this level into the next one and place the next candidate there
+        Frame& frame = stack[depth];
+        if (!frame.remaining) { // no candidate left -> backtrack
+            SUDOKU_STAT(_stats.backtracks++);
+            depth--;
+            enter = false;
+            if (depth < 0) break;
+            continue;
+        }
+        int value = pickValue(frame.remaining);
+        frame.remaining &= ~bit(value);
+        SUDOKU_STAT(_stats.candidatesTried++);
+        states[depth + 1] = states[depth];
+        place(states[depth + 1], frame.cell, value);
+        depth++;
+        enter = true;
+    }
+
+    if (found > 0 && solution && !gaveUp())
+        for (int i = 0; i < numCells; i++) solution->setValueAt(i, _work.solution[i]);
+    if (visit)
+        for (int i = 0; i < numCells; i++) board->setValueAt(i, original[i]);
+    return found;
+}
+
+}
+
+#endif
@@ -1,11 +1,64 @@
 #include "sudoku.h"
+#include "batch.h"
+#include "parallel.h"
+#include "puzzlepool.h"
+#include "puzzlebank.h"
+#include "canonical.h"
+#include "daemon.h"
+#include "puzzleio.h"
+#include "session.h"
+#include "cluetarget.h"
+#include "enumerate.h"
+#include "verify.h"
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <map>
+#include <set>
+#include <thread>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/* =========================================== */
+/* ================ AUXILIARY ================ */
+/* =========================================== */
+
+/* Heap allocations made by the whole program, to check that generation makes none. Only counted in the
+   sudoku_check build (-DSUDOKU_COUNT_ALLOCATIONS): elsewhere every allocation would pay for the shared counter.
+   Not inlined, so the compiler does not pair the malloc and free inside with the new and delete of the callers */
+#ifdef SUDOKU_COUNT_ALLOCATIONS
+static std::atomic<long> allocations(0);
+
+__attribute__((noinline)) void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept { std::free(p); }
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static const bool countingAllocations = true;
+#else
+static std::atomic<long> allocations(0);
+static const bool countingAllocations = false;
+#endif
 
 /* =========================================== */
 /* ================== MAIN =================== */
 /* =========================================== */
 
 int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--batch") return runBatch(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "--bank") return runBank(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "--daemon") return runDaemon(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "--client") return runClient(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "--load") return runLoad(argc - 2, argv + 2);
+    if (argc > 1 && std::string(argv[1]) == "--enumerate") return runEnumerate(argc - 2, argv + 2);
+
     /* 9x9 Sudoku visible test - all difficulties */
     Sudoku* puzzle,* copy;
     for (int difficulty = 1; difficulty < 5; difficulty++) {
@@ -42,19 +95,54 @@ int main(int argc, char* argv[]) {
     /* 9x9 Sudoku exhaustive test - all difficulties */
     std::chrono::steady_clock sc;
     int avg_numClues;
-    double avg_time;
+    double avg_time, avg_solveRaster, avg_solveConstrained, avg_solvePropagated;
+    int noGuesses;
+    SudokuSolver::Deductions deductions;
+    SudokuSolver::SolverStats searchStats, generationStats;
+    SudokuSolver::Options raster, mostConstrained, propagated;
+    raster.cellOrder = SudokuSolver::CellOrder::raster;
+    raster.propagate = false;
+    mostConstrained.cellOrder = SudokuSolver::CellOrder::mostConstrained;
+    mostConstrained.propagate = false;
+    propagated.cellOrder = SudokuSolver::CellOrder::mostConstrained;
+    propagated.propagate = true;
+    propagated.lockedCandidates = true; // off by default on 9x9, on here to count what it removes
 
     for (int difficulty = 1; difficulty < 5; difficulty++) {
         avg_numClues = 0;
         avg_time = 0;
+        avg_solveRaster = 0;
+        avg_solveConstrained = 0;
+        avg_solvePropagated = 0;
+        noGuesses = 0;
+        deductions = SudokuSolver::Deductions();
         std::cout << "-- Difficulty " << difficulty << " --\n";
         for (int i = 0; i < 200; i++) {
             auto start = sc.now();
 
-            puzzle = new Sudoku(difficulty, 9);
+            puzzle = new Sudoku(difficulty, 9, Random::thread(), &generationStats);
             avg_numClues += puzzle->getNumClues();
-            copy = new Sudoku(*puzzle);            
-            SudokuSolver::solve(*copy);
+
+            /* same puzzle solved with each cell order */
+            copy = new Sudoku(*puzzle);
+            auto solveStart = sc.now();
+            SudokuSolver::solve(*copy, raster);
+            avg_solveRaster += static_cast<std::chrono::duration<double>>(sc.now() - solveStart).count();
+
+            *copy = *puzzle;
+            solveStart = sc.now();
+            SudokuSolver::solve(*copy, mostConstrained);
+            avg_solveConstrained += static_cast<std::chrono::duration<double>>(sc.now() - solveStart).count();
+
+            SudokuSolver::Deductions puzzleDeductions;
+            propagated.deductions = &puzzleDeductions;
+            propagated.stats = &searchStats;
+            *copy = *puzzle;
+            solveStart = sc.now();
+            SudokuSolver::solve(*copy, propagated);
+            avg_solvePropagated += static_cast<std::chrono::duration<double>>(sc.now() - solveStart).count();
+            deductions += puzzleDeductions;
+            if (puzzleDeductions.guesses == 0) noGuesses++;
 
             if (!puzzle->isUnique()) { std::cout << "Puzzle is not unique.\n"; delete puzzle; delete copy; exit(1); }
             if (!SudokuSolver::isSolution(*puzzle, *copy)) { std::cout << "Solution is not correct.\n"; delete puzzle; delete copy; exit(1); }
@@ -66,6 +154,559 @@ int main(int argc, char* argv[]) {
         }
         std::cout << "Avg number of clues: " << (double)avg_numClues / (double)200 << "\n";
         std::cout << "Avg time running: " << (double)avg_time / (double)200 << "\n";
+        std::cout << "Avg time solving (raster order): " << (double)avg_solveRaster / (double)200 << "\n";
+        std::cout << "Avg time solving (most constrained cell): " << (double)avg_solveConstrained / (double)200 << "\n";
+        std::cout << "Avg time solving (with deductions): " << (double)avg_solvePropagated / (double)200 << "\n";
+        std::cout << "Avg cells filled by naked singles: " << (double)deductions.nakedSingles / (double)200
+                  << ", hidden singles: " << (double)deductions.hiddenSingles / (double)200 << "\n";
+        std::cout << "Avg candidates removed by locked candidates: " << (double)deductions.lockedCandidates / (double)200 << "\n";
+        std::cout << "Avg guesses: " << (double)deductions.guesses / (double)200
+                  << " (" << noGuesses << " puzzles solved without guessing)\n";
+        std::cout << "Avg search nodes (with deductions): " << (double)searchStats.nodes / (double)200
+                  << ", backtracks: " << (double)searchStats.backtracks / (double)200
+                  << ", max depth: " << searchStats.maxDepth << "\n";
+        std::cout << "Avg uniqueness checks while clearing: " << (double)generationStats.uniquenessChecks / (double)200
+                  << " (" << (double)generationStats.rejectedClears / (double)200 << " rejected)\n";
+    }
+
+    /* Generation into an existing board - no allocation once the buffers of the thread are warm */
+    std::cout << "-- Allocation-free generation --\n";
+    for (int size : {4, 9, 16, 25, 36}) {
+        int numBoards = (size > 16) ? 5 : 20;
+        Random random(size);
+        SudokuSolver::SolverStats stats;
+        Sudoku board(4, size, random, &stats); // warms the buffers
+        long before = allocations.load();
+        auto start = sc.now();
+        for (int i = 0; i < numBoards; i++) board.generate(i % 4 + 1, random, &stats);
+        double generateTime = static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+        long allocated = allocations.load() - before;
+
+        if (allocated != 0) { std::cout << "Generation allocated " << allocated << " times.\n"; exit(1); }
+        if (!board.isUnique()) { std::cout << "Puzzle is not unique.\n"; exit(1); }
+        std::cout << size << "x" << size << ": " << numBoards << (countingAllocations ? " boards without allocating" : " boards (allocations counted by sudoku_check)")
+                  << ", avg time generating " << generateTime / numBoards << "\n";
+    }
+
+    /* Large boards - full grids from the base pattern, without and with the backtracking polish */
+    std::cout << "-- Pattern grids --\n";
+    const char* gridFillNames[2] = {"pattern", "polished pattern"};
+    for (int size : {25, 36}) {
+        for (int f = 0; f < 2; f++) {
+            SudokuSolver::SolverStats stats;
+            for (int i = 0; i < 5; i++) {
+                Random random(i);
+                puzzle = new Sudoku(1, size, random, &stats, f ? Sudoku::GridFill::polishedPattern : Sudoku::GridFill::pattern);
+                copy = new Sudoku(*puzzle);
+                SudokuSolver::solve(*copy);
+
+                if (!puzzle->isUnique()) { std::cout << "Puzzle is not unique.\n"; delete puzzle; delete copy; exit(1); }
+                if (!SudokuSolver::isSolution(*puzzle, *copy)) { std::cout << "Solution is not correct.\n"; delete puzzle; delete copy; exit(1); }
+                delete puzzle;
+                delete copy;
+            }
+            std::cout << size << "x" << size << " " << gridFillNames[f] << ": avg time filling " << stats.fillSeconds / 5
+                      << ", clearing " << stats.clearSeconds / 5 << "\n";
+        }
+    }
+
+    /* Solver engines head to head - solve and uniqueness check of the same puzzles */
+    SudokuSolver::Options engines[2];
+    engines[1].engine = SudokuSolver::Engine::dancingLinks;
+    const char* engineNames[2] = {"backtracking", "dancing links"};
+
+    for (int size : {9, 16}) {
+        int numPuzzles = (size == 9) ? 200 : 20, difficulty = (size == 9) ? 4 : 1;
+        double engineTime[2] = {0, 0};
+        std::cout << "-- Engines " << size << "x" << size << " --\n";
+        for (int i = 0; i < numPuzzles; i++) {
+            puzzle = new Sudoku(difficulty, size);
+            copy = new Sudoku(*puzzle);
+            for (int e = 0; e < 2; e++) {
+                *copy = *puzzle;
+                auto start = sc.now();
+                SudokuSolver::solve(*copy, engines[e]);
+                bool unique = SudokuSolver::isUnique(*puzzle, engines[e]);
+                engineTime[e] += static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+
+                if (!unique) { std::cout << "Puzzle is not unique.\n"; delete puzzle; delete copy; exit(1); }
+                if (!SudokuSolver::isSolution(*puzzle, *copy)) { std::cout << "Solution is not correct.\n"; delete puzzle; delete copy; exit(1); }
+            }
+            delete puzzle;
+            delete copy;
+        }
+        for (int e = 0; e < 2; e++)
+            std::cout << "Avg time solving and checking uniqueness (" << engineNames[e] << "): " << engineTime[e] / numPuzzles << "\n";
+    }
+
+    /* Clues that clash leave no solution to find, whatever the engine or cell order */
+    {
+        std::vector<Sudoku::Value> values(81, 0);
+        values[0] = values[1] = 1;
+        Sudoku clashing(9, values.data());
+        SudokuSolver::Options plainSearch;
+        plainSearch.cellOrder = SudokuSolver::CellOrder::raster;
+        plainSearch.propagate = false;
+        for (const SudokuSolver::Options& options : {engines[0], engines[1], plainSearch})
+            if (SudokuSolver::hasSolutionWithout(clashing, 2, 3, options)) { std::cout << "Clashing clues have a solution.\n"; exit(1); }
+    }
+
+    /* A draft value in the tested cell is ignored and kept, by the fixed-size engine (9x9) and the generic one (36x36) */
+    for (int size : {9, 36}) {
+        Sudoku board(1, size);
+        Sudoku solution(board);
+        SudokuSolver::solve(solution);
+        int cell = 0;
+        while (!board.isDraftAt(cell)) cell++;
+        int value = solution.valueAt(cell), other = value % size + 1;
+        bool same = true;
+        for (int draft : {value, other}) {
+            board.setValueAt(cell, draft);
+            same = same && !SudokuSolver::hasSolutionWithout(board, cell, value) && SudokuSolver::hasSolutionWithout(board, cell, other)
+                && board.valueAt(cell) == draft;
+        }
+        if (!same) { std::cout << "Draft value of the tested cell changes the answer (" << size << "x" << size << ").\n"; exit(1); }
+    }
+
+    /* Solution checking: every kernel of this processor agrees with the scalar check, board by board.
+       Three boards in four are broken: two cells of a row swapped, a clue changed, or a value out of range */
+    std::cout << "-- Solution checking 9x9 --\n";
+    {
+        const int numBoards = 64;
+        std::vector<Sudoku::Value> clues(numBoards * 81), grids(numBoards * 81);
+        int broken = 0;
+        for (int k = 0; k < numBoards; k++) {
+            Sudoku board(1, 9);
+            Sudoku solution(board);
+            SudokuSolver::solve(solution);
+            Sudoku::Value* clue = clues.data() + k * 81,* grid = grids.data() + k * 81;
+            for (int i = 0; i < 81; i++) {
+                clue[i] = board.isDraftAt(i) ? 0 : board.valueAt(i);
+                grid[i] = solution.valueAt(i);
+            }
+            if (k % 4 == 1) std::swap(grid[9 * (k % 9)], grid[9 * (k % 9) + 1]);
+            else if (k % 4 == 2) {
+                int i = 0;
+                while (clue[i] == 0) i++;
+                clue[i] = clue[i] % 9 + 1;
+            }
+            else if (k % 4 == 3) grid[k % 81] = 10;
+            broken += k % 4 != 0;
+        }
+        std::unique_ptr<bool[]> expected(new bool[numBoards]), ok(new bool[numBoards]);
+        for (const Sudoku::Value* puzzles : {(const Sudoku::Value*) clues.data(), (const Sudoku::Value*) nullptr}) {
+            size_t failed = verifySolutions("scalar", 9, puzzles, grids.data(), numBoards, expected.get());
+            if (puzzles && failed != (size_t) broken) { std::cout << "Scalar check is not correct.\n"; exit(1); }
+            for (const char* kernel : {"ssse3", "avx2"}) {
+                try {
+                    if (verifySolutions(kernel, 9, puzzles, grids.data(), numBoards, ok.get()) != failed
+                        || !std::equal(ok.get(), ok.get() + numBoards, expected.get())) {
+                        std::cout << kernel << " check differs from the scalar one.\n"; exit(1);
+                    }
+                }
+                catch (const std::runtime_error&) {} // not on this processor
+            }
+        }
+        std::cout << numBoards << " boards, " << broken << " broken, checked with " << verifyKernel(9) << "\n";
+    }
+
+    /* Parallel single puzzle search - same answers as the sequential one */
+    std::cout << "-- Parallel 16x16 --\n";
+    ThreadPool pool;
+    double sequentialTime = 0, parallelTime = 0;
+    for (int i = 0; i < 20; i++) {
+        puzzle = new Sudoku(1, 16);
+        copy = new Sudoku(*puzzle);
+
+        auto start = sc.now();
+        SudokuSolver::solve(*copy);
+        bool unique = puzzle->isUnique();
+        sequentialTime += static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+
+        *copy = *puzzle;
+        start = sc.now();
+        SudokuSolver::solveParallel(*copy, pool);
+        bool uniqueParallel = SudokuSolver::isUniqueParallel(*puzzle, pool);
+        parallelTime += static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+
+        if (!unique || !uniqueParallel) { std::cout << "Puzzle is not unique.\n"; delete puzzle; delete copy; exit(1); }
+        if (!SudokuSolver::isSolution(*puzzle, *copy)) { std::cout << "Solution is not correct.\n"; delete puzzle; delete copy; exit(1); }
+        delete puzzle;
+        delete copy;
+    }
+    std::cout << "Avg time solving and checking uniqueness (" << pool.size() << " threads): " << parallelTime / 20
+              << " (sequential " << sequentialTime / 20 << ")\n";
+    {
+        // a cancel raised while the subtrees are being searched stops them, and leaves the count unsettled
+        std::vector<Sudoku::Value> none(81, 0);
+        Sudoku empty(9, none.data());
+        std::atomic<bool> cancel(false);
+        SudokuSolver::Options cancellable;
+        cancellable.cancel = &cancel;
+        std::thread canceller([&] { std::this_thread::sleep_for(std::chrono::milliseconds(50)); cancel = true; });
+        auto start = sc.now();
+        int found = SudokuSolver::countSolutionsParallel(empty, 1 << 30, pool, cancellable);
+        canceller.join();
+        if (static_cast<std::chrono::duration<double>>(sc.now() - start).count() > 2) { std::cout << "Parallel search was not cancelled.\n"; exit(1); }
+        if (found != SudokuSolver::gaveUp) { std::cout << "Cancelled parallel count looks complete.\n"; exit(1); }
+    }
+
+    /* Ready puzzles from the pre-generation pool */
+    std::cout << "-- Puzzle pool 9x9 --\n";
+    std::vector<PuzzlePool::Kind> kinds;
+    for (int difficulty = 1; difficulty < 5; difficulty++) kinds.push_back({9, difficulty});
+    PuzzlePool puzzlePool(kinds, 64, 16, 1);
+    puzzlePool.waitFull();
+    for (int difficulty = 1; difficulty < 5; difficulty++) {
+        double takeTime = 0;
+        for (int i = 0; i < 48; i++) {
+            auto start = sc.now();
+            std::unique_ptr<Sudoku> ready = puzzlePool.take(9, difficulty);
+            takeTime += static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+            if (!ready->isUnique()) { std::cout << "Puzzle is not unique.\n"; exit(1); }
+        }
+        PuzzlePool::Stats stats = puzzlePool.stats(9, difficulty);
+        std::cout << "Difficulty " << difficulty << ": avg time taking a puzzle " << takeTime / 48 << ", " << stats.hits << " hits, "
+                  << stats.misses << " misses, depth " << stats.depth << "/" << stats.capacity << ", refill rate "
+                  << stats.refillRate << " puzzles/s\n";
+    }
+    {
+        // takes down to below the low-water mark wake the generator, which fills every queue up again
+        auto start = sc.now();
+        for (int difficulty = 1; difficulty < 5; difficulty++)
+            while (puzzlePool.stats(9, difficulty).depth >= 16) puzzlePool.take(9, difficulty);
+        for (int difficulty = 1; difficulty < 5; difficulty++)
+            while (puzzlePool.stats(9, difficulty).depth < 64) std::this_thread::yield();
+        for (int difficulty = 1; difficulty < 5; difficulty++)
+            if (puzzlePool.stats(9, difficulty).depth != 64) { std::cout << "Puzzle pool was not refilled.\n"; exit(1); }
+        std::cout << "Refilled below the low-water mark in " << static_cast<std::chrono::duration<double>>(sc.now() - start).count() << " s\n";
+    }
+
+    /* Puzzle bank written and mapped back */
+    std::cout << "-- Puzzle bank 9x9 --\n";
+    const char* bankPath = "sudoku_selftest.bank";
+    std::vector<Sudoku*> banked;
+    PuzzleBankWriter bankWriter;
+    for (int difficulty = 1; difficulty < 5; difficulty++)
+        for (int i = 0; i < 25; i++) {
+            banked.push_back(new Sudoku(difficulty, 9));
+            bankWriter.add(*banked.back(), difficulty);
+        }
+    bankWriter.write(bankPath);
+    {
+        PuzzleBank bank(bankPath);
+        Sudoku board;
+        for (int difficulty = 1; difficulty < 5; difficulty++) {
+            if (bank.count(9, difficulty) != 25) { std::cout << "Bank lost puzzles.\n"; exit(1); }
+            for (size_t k = 0; k < 25; k++) {
+                PuzzleView view = bank.find(9, difficulty, k);
+                view.load(board);
+                Sudoku solution(board);
+                view.load(solution, true);
+                if (!SudokuSolver::isSolution(board, solution)) { std::cout << "Bank solution is not correct.\n"; exit(1); }
+            }
+        }
+        for (Sudoku* puzzle : banked) { // every puzzle comes back, wherever its group put it
+            bool found = false;
+            for (size_t k = 0; k < bank.size() && !found; k++) {
+                PuzzleView view = bank.at(k);
+                found = view.getNumClues() == puzzle->getNumClues();
+                for (int i = 0; i < 81 && found; i++) found = view.valueAt(i) == puzzle->valueAt(i);
+            }
+            if (!found) { std::cout << "Bank lost a puzzle.\n"; exit(1); }
+            delete puzzle;
+        }
+        std::cout << bank.size() << " puzzles in " << bank.numGroups() << " groups, "
+                  << PuzzleBankFormat::recordBytes(9) << " bytes each\n";
+    }
+    {
+        int bits[6][2] = {{4, 2}, {9, 4}, {16, 4}, {25, 5}, {36, 6}, {49, 6}};
+        for (auto& expected : bits)
+            if (PuzzleBankFormat::bitsPerCell(expected[0]) != expected[1]) { std::cout << "Bank cell width is not correct.\n"; exit(1); }
+
+        // the same bank as written by a host of the other byte order
+        std::FILE* file = std::fopen(bankPath, "r+b");
+        unsigned char version[4];
+        bool swapped = file && std::fseek(file, 8, SEEK_SET) == 0 && std::fread(version, 1, 4, file) == 4;
+        std::reverse(version, version + 4);
+        swapped = swapped && std::fseek(file, 8, SEEK_SET) == 0 && std::fwrite(version, 1, 4, file) == 4;
+        if (file) std::fclose(file);
+        bool rejected = false;
+        try { PuzzleBank foreign(bankPath); }
+        catch (const std::runtime_error&) { rejected = true; }
+        if (!swapped || !rejected) { std::cout << "Bank of the other byte order was not rejected.\n"; exit(1); }
+    }
+    std::remove(bankPath);
+
+    /* Result cache 9x9: each puzzle, then shuffled copies of it (same symmetry class) */
+    std::cout << "-- Result cache 9x9 --\n";
+    auto shuffled = [](const Sudoku& board, Random& random) {
+        std::vector<int> bands = {0, 1, 2}, stacks = {0, 1, 2}, digits = {1, 2, 3, 4, 5, 6, 7, 8, 9}, rows, cols;
+        random.shuffle(bands);
+        random.shuffle(stacks);
+        random.shuffle(digits);
+        for (int b = 0; b < 3; b++) {
+            std::vector<int> inBand = {3*bands[b], 3*bands[b] + 1, 3*bands[b] + 2}, inStack = {3*stacks[b], 3*stacks[b] + 1, 3*stacks[b] + 2};
+            random.shuffle(inBand);
+            random.shuffle(inStack);
+            rows.insert(rows.end(), inBand.begin(), inBand.end());
+            cols.insert(cols.end(), inStack.begin(), inStack.end());
+        }
+        bool transpose = random.uniform(0, 1);
+        Sudoku::Value values[81];
+        for (int i = 0; i < 81; i++) {
+            int value = transpose ? board.valueAt(cols[i % 9]*9 + rows[i / 9]) : board.valueAt(rows[i / 9]*9 + cols[i % 9]);
+            values[i] = value ? digits[value - 1] : 0;
+        }
+        return Sudoku(9, values);
+    };
+    ResultCache resultCache;
+    double cachedTime = 0, solveTime = 0;
+    for (int i = 0; i < 40; i++) {
+        Sudoku original(1 + i % 4, 9);
+        for (int copies = 0; copies < 5; copies++) {
+            Sudoku board = copies ? shuffled(original, Random::thread()) : original;
+            Sudoku solved(board);
+            auto start = sc.now();
+            int found = resultCache.countSolutions(solved, 2);
+            (copies ? cachedTime : solveTime) += static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+            if (found != 1 || !SudokuSolver::isSolution(board, solved)) { std::cout << "Cached solution is not correct.\n"; exit(1); }
+        }
+    }
+    {
+        Sudoku hard(4, 9), counted(hard);
+        SudokuSolver::Options budget;
+        budget.nodeBudget = 1;
+        long entries = resultCache.stats().entries;
+        if (resultCache.countSolutions(hard, 2, budget) != SudokuSolver::gaveUp || resultCache.stats().entries != entries
+            || resultCache.countSolutions(counted, 2) != 1) { std::cout << "Cache kept a search that gave up.\n"; exit(1); }
+    }
+    ResultCache::Stats cacheStats = resultCache.stats();
+    if (cacheStats.hits + cacheStats.uncacheable < 160) { std::cout << "Cache missed a shuffled puzzle.\n"; exit(1); }
+    std::cout << cacheStats.hits << " hits of " << cacheStats.lookups << " lookups, " << cacheStats.entries << " entries, "
+              << cacheStats.canonicalSeconds / cacheStats.lookups << " s per canonical form, avg time solving "
+              << solveTime / 40 << ", from the cache " << cachedTime / 160 << "\n";
+
+    /* Board sessions: random moves, undos and redos, conflicts checked against every cell after each */
+    std::cout << "-- Board sessions 9x9 --\n";
+    {
+        long numMoves = 0;
+        double moveTime = 0;
+        std::vector<bool> before(81);
+        for (int game = 0; game < 20; game++) {
+            Random random(game);
+            Sudoku board(1 + game % 4, 9, random);
+            Sudoku solution(board);
+            SudokuSolver::solve(solution);
+            BoardSession session(board, 16);
+
+            for (int step = 0; step < 500; step++) {
+                for (int i = 0; i < 81; i++) before[i] = session.board().conflictsAt(i);
+                int action = random.uniform(0, 9), cell = random.uniform(0, 80);
+                auto start = sc.now();
+                BoardSession::Change change = (action == 0) ? session.undo() : (action == 1) ? session.redo()
+                    : session.play(Coords(cell % 9, cell / 9), (action < 5) ? solution.valueAt(cell) : random.uniform(0, 9));
+                moveTime += static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+                numMoves++;
+
+                // the change lists exactly the cells whose conflict flipped
+                int flipped = 0, conflicts = 0;
+                bool listed = true;
+                for (int i = 0; i < 81; i++) {
+                    bool now = session.board().conflictsAt(i);
+                    conflicts += now;
+                    if (now == before[i]) continue;
+                    flipped++;
+                    const int* cells = now ? change.conflicting : change.resolved;
+                    int numCells = now ? change.numConflicting : change.numResolved;
+                    listed = listed && std::find(cells, cells + numCells, i) != cells + numCells;
+                }
+                if (!listed || flipped != change.numConflicting + change.numResolved || conflicts != session.getNumConflicts()
+                    || session.isConflicting(Coords(cell % 9, cell / 9)) != session.board().conflictsAt(cell)) {
+                    std::cout << "Session conflicts are not correct.\n"; exit(1);
+                }
+            }
+
+            // finishing the solution completes the board
+            for (int i = 0; i < 81; i++) session.play(Coords(i % 9, i / 9), solution.valueAt(i));
+            if (!session.isComplete() || session.getNumFilled() != 81) { std::cout << "Session is not complete.\n"; exit(1); }
+            BoardSession::Change undone = session.undo();
+            if (undone.applied && (session.isComplete() || undone.complete)) { std::cout << "Session is still complete.\n"; exit(1); }
+        }
+        std::cout << numMoves << " moves, avg time per move " << moveTime / numMoves << ", "
+                  << sizeof(BoardSession) << " bytes per session plus its board and history\n";
+    }
+
+    /* Clue target: racing on the pool down to 22 clues, then the fewest within a node budget on one thread */
+    std::cout << "-- Clue target 9x9 --\n";
+    {
+        Random random(23);
+        int usualClues = 0;
+        for (int i = 0; i < 20; i++) usualClues += Sudoku(4, 9, random).getNumClues();
+
+        ClueTarget targets[2];
+        targets[0].numClues = 22;
+        targets[0].seconds = 5;
+        targets[1].seconds = 0;
+        targets[1].nodeBudget = 50000;
+        for (int t = 0; t < 2; t++) {
+            ClueReport report;
+            Sudoku puzzle = generateWithClues(9, targets[t], random, &report, t == 0 ? &pool : nullptr);
+            if (!puzzle.isUnique()) { std::cout << "Puzzle is not unique.\n"; exit(1); }
+            if (report.numClues != puzzle.getNumClues() || report.reached != (report.numClues <= targets[t].numClues)
+                || (report.minimal != Minimality::unknown && (report.minimal == Minimality::yes) != isMinimal(puzzle))) {
+                std::cout << "Clue report is not correct.\n"; exit(1);
+            }
+            std::cout << report.numClues << " clues" << (report.minimal == Minimality::yes ? " (minimal)" : report.minimal == Minimality::unknown ? " (maybe minimal)" : "")
+                      << " in " << report.seconds << " s, "
+                      << report.attempts << " grids, " << report.perturbations << " perturbations, " << report.stats.nodes << " nodes\n";
+        }
+        // a budget spent by the first clearing leaves none to check minimality with
+        ClueTarget tiny;
+        tiny.seconds = 0;
+        tiny.nodeBudget = 1;
+        ClueReport report;
+        generateWithClues(9, tiny, random, &report);
+        if (report.minimal != Minimality::unknown) {
+            std::cout << "Minimality was checked beyond the clue budget.\n"; exit(1);
+        }
+        // called from the only worker of its pool, whose own attempt never gets to run
+        ThreadPool single(1);
+        Sudoku fromWorker;
+        single.submit([&](int) { ClueTarget quick; quick.seconds = 0.05; fromWorker = generateWithClues(9, quick, random, nullptr, &single); });
+        single.wait();
+        if (!fromWorker.isUnique()) { std::cout << "Puzzle is not unique.\n"; exit(1); }
+        std::cout << "(difficulty 4 generation averages " << usualClues / 20.0 << " clues)\n";
+    }
+
+    /* Enumeration: every solution once, the same count as the sequential search, and the same total
+       after stopping halfway and resuming from the checkpoint */
+    std::cout << "-- Enumeration 9x9 --\n";
+    {
+        Random random(24);
+        Sudoku sparse(4, 9, random);
+        int expected = 1;
+        for (int i = 0; i < 81 && expected < 2000; i++) {
+            if (sparse.isDraftAt(i)) continue;
+            std::vector<Sudoku::Value> values(81);
+            for (int j = 0; j < 81; j++) values[j] = (j == i || sparse.isDraftAt(j)) ? 0 : sparse.valueAt(j);
+            Sudoku fewer(9, values.data());
+            Sudoku copy(fewer);
+            expected = SudokuSolver::countSolutions(copy, 1 << 30);
+            sparse = fewer;
+        }
+
+        std::mutex mutex;
+        std::set<std::string> seen;
+        bool valid = true;
+        SudokuSolver::EnumerationOptions enumeration;
+        enumeration.onSolution = [&](const Sudoku& solution, int) {
+            char line[81];
+            formatPuzzle(solution, line);
+            std::lock_guard<std::mutex> lock(mutex);
+            valid = valid && SudokuSolver::isSolution(sparse, solution) && seen.insert(std::string(line, 81)).second;
+            return true;
+        };
+        SudokuSolver::EnumerationReport report;
+        uint64_t found = SudokuSolver::enumerateSolutions(sparse, pool, enumeration, &report);
+        if (found != (uint64_t) expected || seen.size() != found || !valid || !report.complete) {
+            std::cout << "Enumeration is not correct.\n"; exit(1);
+        }
+        std::cout << found << " solutions in " << report.seconds << " s (" << found / report.seconds << " per second), "
+                  << report.subtrees << " subtrees\n";
+
+        std::string checkpoint = "/tmp/sudoku-enumeration-" + std::to_string(getpid());
+        std::atomic<long> visited(0);
+        enumeration.checkpoint = checkpoint;
+        enumeration.onSolution = [&](const Sudoku&, int) { return ++visited < expected / 2; };
+        SudokuSolver::enumerateSolutions(sparse, pool, enumeration, &report);
+        bool stopped = !report.complete && !report.resumed;
+        enumeration.onSolution = nullptr;
+        found = SudokuSolver::enumerateSolutions(sparse, pool, enumeration, &report);
+        std::remove(checkpoint.c_str());
+        if (!stopped || !report.resumed || !report.complete || found != (uint64_t) expected) {
+            std::cout << "Resumed enumeration is not correct.\n"; exit(1);
+        }
+
+        // out of node budget: the solutions visited so far, on both engines
+        std::vector<Sudoku::Value> none(81, 0);
+        Sudoku empty(9, none.data());
+        SudokuSolver::Options budget;
+        budget.nodeBudget = 100;
+        for (int e = 0; e < 2; e++) {
+            budget.cellOrder = e ? SudokuSolver::CellOrder::raster : SudokuSolver::CellOrder::mostConstrained;
+            uint64_t visitedInBudget = SudokuSolver::forEachSolution(empty, SudokuSolver::SolutionVisitor(), budget);
+            if (visitedInBudget > 100) { std::cout << "Enumeration out of budget is not correct.\n"; exit(1); }
+        }
+
+        // a checkpoint that cannot be written stops the workers before the error comes out
+        SudokuSolver::EnumerationOptions unwritable;
+        unwritable.checkpoint = "/nonexistent/sudoku-enumeration";
+        unwritable.checkpointSeconds = 0;
+        bool thrown = false;
+        try { SudokuSolver::enumerateSolutions(empty, pool, unwritable); }
+        catch (const std::runtime_error&) { thrown = true; }
+        if (!thrown) { std::cout << "Unwritable checkpoint was not reported.\n"; exit(1); }
+
+        // draft values come back after the visit
+        Sudoku drafted(sparse);
+        int draftCell = 0;
+        while (!drafted.isDraftAt(draftCell)) draftCell++;
+        Sudoku solved(sparse);
+        SudokuSolver::solve(solved);
+        drafted.setValueAt(draftCell, solved.valueAt(draftCell));
+        SudokuSolver::forEachSolution(drafted, [](const Sudoku&) { return true; });
+        if (drafted.valueAt(draftCell) != solved.valueAt(draftCell)) { std::cout << "Enumeration changed the board.\n"; exit(1); }
+    }
+
+    /* Daemon on the other end of a socket pair - every command, replies matched by id */
+    std::cout << "-- Daemon --\n";
+    {
+        DaemonOptions daemonOptions;
+        daemonOptions.threads = 2;
+        daemonOptions.batchSize = 8;
+        SolverDaemon daemon(daemonOptions);
+        int fds[2];
+        if (socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0) { std::cout << "No socket pair.\n"; exit(1); }
+        std::thread server([&] { daemon.serve(fds[1], fds[1]); close(fds[1]); });
+
+        char line[2 * 81 + 1];
+        std::vector<std::string> solutions;
+        std::string requests;
+        for (int i = 0; i < 40; i++) {
+            Sudoku board(1 + i % 4, 9);
+            Sudoku solution(board);
+            SudokuSolver::solve(solution);
+            solutions.push_back(std::string(line, formatPuzzle(solution, line)));
+            requests += "s" + std::to_string(i) + " solve " + std::string(line, formatPuzzle(board, line)) + "\n";
+            if (i == 0) requests += "v verify " + std::string(line, formatPuzzle(board, line)) + " " + solutions[0] + "\n";
+        }
+        Random generateRandom(5);
+        Sudoku generated(2, 9, generateRandom);
+        std::string empty(81, '.');
+        requests += "u unique " + empty + "\nc count 3 " + empty + "\ng generate 9 2 5\nx frobnicate\n";
+        if (write(fds[0], requests.data(), requests.size()) != (ssize_t) requests.size()) { std::cout << "Daemon write failed.\n"; exit(1); }
+        shutdown(fds[0], SHUT_WR);
+
+        std::string received;
+        char buffer[4096];
+        for (ssize_t n; (n = read(fds[0], buffer, sizeof buffer)) > 0; ) received.append(buffer, n);
+        server.join();
+        close(fds[0]);
+
+        std::map<std::string, std::string> replies;
+        for (size_t begin = 0, end; (end = received.find('\n', begin)) != std::string::npos; begin = end + 1) {
+            size_t split = received.find(' ', begin);
+            replies[received.substr(begin, split - begin)] = received.substr(split + 1, end - split - 1);
+        }
+        bool ok = replies.size() == 45 && replies["v"] == "valid" && replies["u"] == "multiple" && replies["c"] == "3"
+               && replies["g"] == std::string(line, formatPuzzle(generated, line)) && replies["x"] == "error unknown command";
+        for (int i = 0; i < 40 && ok; i++) ok = replies["s" + std::to_string(i)] == solutions[i];
+        if (!ok) { std::cout << "Daemon reply is not correct.\n"; exit(1); }
+
+        SolverDaemon::Stats daemonStats = daemon.stats();
+        std::cout << daemonStats.requests << " requests in " << daemonStats.batches << " batches, "
+                  << daemonStats.errors << " errors\n";
     }
 
     return 0;
@@ -0,0 +1,127 @@
+#include "parallel.h"
+
+#include <memory>
+
+/* =========================================== */
+/* ========= PARALLEL SINGLE PUZZLE ========== */
+/* =========================================== */
+
+static const int subtreesPerThread = 8;
+
+namespace {
+
+/* State shared by the caller and the pool tasks (kept alive by the last of them) */
+struct ParallelSearch {
+    std::vector<Sudoku> subtrees;
+    SudokuSolver::Options options;
+    int limit;
+
+    std::atomic<bool> cancel;           // the limit is reached: the caller's flag, if any, is the outer cancel
+    std::atomic<size_t> next;           // next subtree to search
+    std::atomic<int> found;
+    std::atomic<bool> gaveUp;           // some subtree ran out of its node budget
+
+    std::mutex mutex;
+    std::condition_variable allDone;
+    size_t finished = 0;                // subtrees searched (or skipped after cancelling)
+    std::unique_ptr<Sudoku> solution;   // first solution found
+    SudokuSolver::Deductions deductions;
+    SudokuSolver::SolverStats stats;
+
+    ParallelSearch(const SudokuSolver::Options& searchOptions, int searchLimit)
+        : options(searchOptions), limit(searchLimit), cancel(false), next(0), found(0), gaveUp(false) {
+        options.outerCancel = searchOptions.cancel;
+        options.cancel = &cancel;
+        options.deductions = nullptr;
+        options.stats = nullptr;
+    }
+
+    void searchSubtrees();
+};
+
+/* Takes subtrees until none is left */
+void ParallelSearch::searchSubtrees() {
+    for (size_t i = next++; i < subtrees.size(); i = next++) {
+        Sudoku& subtree = subtrees[i];
+        SudokuSolver::Deductions subtreeDeductions;
+        SudokuSolver::SolverStats subtreeStats;
+        SudokuSolver::Options subtreeOptions = options;
+        subtreeOptions.deductions = &subtreeDeductions;
+        subtreeOptions.stats = &subtreeStats;
+
+        int subtreeFound = options.cancelled() ? 0 : SudokuSolver::countSolutions(subtree, limit, subtreeOptions);
+        if (subtreeFound == SudokuSolver::gaveUp) gaveUp = true;
+        if (subtreeFound > 0 && found.fetch_add(subtreeFound) + subtreeFound >= limit) cancel = true;
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (subtreeFound > 0 && !solution) solution.reset(new Sudoku(subtree));
+        deductions += subtreeDeductions;
+        stats += subtreeStats;
+        if (++finished == subtrees.size()) allDone.notify_all();
+    }
+}
+
+/* Searches the puzzle's subtrees on the pool, returns the solutions found up to limit, or gaveUp when a subtree
+   ran out of node budget or the caller cancelled before the limit was reached: the count is not settled then.
+   If there are any, the puzzle is left holding one of them. The node budget applies to each subtree */
+int searchParallel(Sudoku& puzzle, int limit, ThreadPool& pool, const SudokuSolver::Options& options) {
+    if (puzzle.hasConflicts()) return 0;
+    std::shared_ptr<ParallelSearch> search = std::make_shared<ParallelSearch>(options, limit);
+    search->subtrees.push_back(puzzle);
+    SudokuSolver::splitSearch(search->subtrees, subtreesPerThread * pool.size());
+
+    for (int w = 0; w < pool.size(); w++)
+        pool.submit([search](int) { search->searchSubtrees(); });
+    search->searchSubtrees();
+
+    std::unique_lock<std::mutex> lock(search->mutex);
+    search->allDone.wait(lock, [&] { return search->finished == search->subtrees.size(); });
+    if (options.deductions) *options.deductions += search->deductions;
+    if (options.stats) *options.stats += search->stats;
+    bool stopped = options.cancel && options.cancel->load();
+    if (search->found < limit && (search->gaveUp || stopped)) return SudokuSolver::gaveUp; // the count is not settled
+    if (search->solution) puzzle = *search->solution;
+    return std::min(search->found.load(), limit);
+}
+
+}
+
+/* A forced cell is filled as a branch of one. Full boards and dead ends are kept as they are - their search ends at once */
+void SudokuSolver::splitSearch(std::vector<Sudoku>& subtrees, size_t target) {
+    std::vector<Sudoku> children;
+    bool branched = true;
+    while (branched && subtrees.size() < target) {
+        branched = false;
+        children.clear();
+        for (Sudoku& board : subtrees) {
+            int cell = -1, bestCount = board.getSize() + 1;
+            for (int i = 0; i < board.getNumCells() && bestCount > 2; i++) {
+                if (board.valueAt(i) != 0) continue;
+                int count = popCount(board.candidatesAt(i));
+                if (count < bestCount) { cell = i; bestCount = count; }
+            }
+            if (cell < 0 || bestCount == 0) { children.push_back(board); continue; }
+
+            for (Sudoku::Mask candidates = board.candidatesAt(cell); candidates; candidates &= candidates - 1) {
+                children.push_back(board);
+                children.back().setValueAt(cell, lowestBit(candidates));
+            }
+            branched = true;
+        }
+        subtrees.swap(children);
+    }
+}
+
+bool SudokuSolver::solveParallel(Sudoku& puzzle, ThreadPool& pool, const Options& options) {
+    for (int i = 0; i < puzzle.getNumCells(); i++) puzzle.setValueAt(i, 0);
+    return searchParallel(puzzle, 1, pool, options) == 1;
+}
+
+int SudokuSolver::countSolutionsParallel(Sudoku& puzzle, int limit, ThreadPool& pool, const Options& options) {
+    return searchParallel(puzzle, limit, pool, options);
+}
+
+bool SudokuSolver::isUniqueParallel(const Sudoku& puzzle, ThreadPool& pool, const Options& options) {
+    Sudoku copy = Sudoku(puzzle); // preserve board - we do not want to solve it
+    return searchParallel(copy, 2, pool, options) == 1;
+}
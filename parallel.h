@@ -0,0 +1,29 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "sudoku.h"
+#include "threadpool.h"
+
+/* =========================================== */
+/* ========= PARALLEL SINGLE PUZZLE ========== */
+/* =========================================== */
+
+/* Splits the search tree of one puzzle at its top branching levels and searches the subtrees
+   on a thread pool. The first solution (or the limit-th one when counting) cancels the other
+   subtrees. The calling thread searches subtrees too, so these may be called from a pool worker.
+   Every subtree search also reads the cancel flag of the options: a cancel before the limit is reached
+   makes the count unsettled, so countSolutionsParallel returns gaveUp and the others false */
+
+namespace SudokuSolver {
+    bool solveParallel(Sudoku& puzzle, ThreadPool& pool, const Options& options = Options());
+
+    int countSolutionsParallel(Sudoku& puzzle, int limit, ThreadPool& pool, const Options& options = Options());
+
+    bool isUniqueParallel(const Sudoku& puzzle, ThreadPool& pool, const Options& options = Options());
+
+    /* Replaces the boards by their subtrees, branching on the most constrained cell of every open board,
+       until there are at least target of them or nothing is left to branch on */
+    void splitSearch(std::vector<Sudoku>& subtrees, size_t target);
+}
+
+#endif
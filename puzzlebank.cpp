@@ -0,0 +1,244 @@
+#include "puzzlebank.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* =========================================== */
+/* ================ PUZZLE BANK ============== */
+/* =========================================== */
+
+using namespace PuzzleBankFormat;
+
+static const char bankMagic[8] = {'S', 'U', 'D', 'O', 'K', 'U', 'B', '1'};
+static const uint32_t bankVersion = 1;
+
+int PuzzleBankFormat::bitsPerCell(int size) {
+    int bits = 1;
+    while ((1 << bits) < size) bits++;
+    return bits;
+}
+
+uint32_t PuzzleBankFormat::recordBytes(int size) {
+    int numCells = size*size;
+    return (numCells * bitsPerCell(size) + 7) / 8 + (numCells + 7) / 8;
+}
+
+/* ================ PUZZLE VIEW ============== */
+
+int PuzzleView::solutionAt(int i) const {
+    int bits = _group->bitsPerCell;
+    if (bits == 4) return ((_record[i >> 1] >> ((i & 1) * 4)) & 15) + 1;
+    int bit = i * bits, shift = bit & 7;
+    unsigned packed = _record[bit >> 3];
+    if (shift + bits > 8) packed |= unsigned(_record[(bit >> 3) + 1]) << 8;
+    return ((packed >> shift) & ((1u << bits) - 1)) + 1;
+}
+
+void PuzzleView::load(Sudoku& board, bool solution) const {
+    if (board.getSize() != getSize()) throw std::invalid_argument("Board and bank puzzle sizes differ.");
+    Sudoku::Value values[Sudoku::maxSize * Sudoku::maxSize];
+    for (int i = 0; i < getSize()*getSize(); i++) values[i] = solution ? solutionAt(i) : valueAt(i);
+    board.load(values);
+}
+
+Sudoku PuzzleView::puzzle() const {
+    Sudoku::Value values[Sudoku::maxSize * Sudoku::maxSize];
+    for (int i = 0; i < getSize()*getSize(); i++) values[i] = valueAt(i);
+    return Sudoku(getSize(), values);
+}
+
+/* ================ BANK READER ============== */
+
+PuzzleBank::PuzzleBank(const char* path) : _fd(-1), _data(nullptr), _length(0) {
+    _fd = open(path, O_RDONLY);
+    if (_fd < 0) throw std::runtime_error(std::string("Cannot open ") + path);
+    struct stat info;
+    if (fstat(_fd, &info) != 0 || (size_t) info.st_size < sizeof(Header)) {
+        close(_fd);
+        throw std::runtime_error(std::string("Not a puzzle bank: ") + path);
+    }
+    _length = info.st_size;
+    void* data = mmap(nullptr, _length, PROT_READ, MAP_SHARED, _fd, 0);
+    if (data == MAP_FAILED) {
+        close(_fd);
+        throw std::runtime_error(std::string("Cannot map ") + path);
+    }
+    _data = static_cast<const uint8_t*>(data);
+    _header = reinterpret_cast<const Header*>(_data);
+    _groups = reinterpret_cast<const Group*>(_data + _header->groupsOffset);
+
+    // check everything the views rely on, once (the version of a bank in the other byte order reads as 1 << 24)
+    bool valid = std::memcmp(_header->magic, bankMagic, 8) == 0 && _header->version == bankVersion
+        && _header->groupsOffset % alignof(Group) == 0
+        && _header->groupsOffset <= _length && _header->numGroups <= (_length - _header->groupsOffset) / sizeof(Group);
+    uint64_t total = 0;
+    for (uint32_t g = 0; valid && g < _header->numGroups; g++) {
+        const Group& group = _groups[g];
+        int boxSize = (int) sqrt(group.size);
+        valid = group.size >= 1 && group.size <= Sudoku::maxSize && boxSize * boxSize == group.size
+            && group.bitsPerCell == bitsPerCell(group.size) && group.recordBytes == recordBytes(group.size)
+            && group.count > 0 && group.offset <= _length && group.count <= (_length - group.offset) / group.recordBytes;
+        _firstIndex.push_back(total);
+        total += group.count;
+    }
+    if (!valid || total != _header->numPuzzles) {
+        munmap(data, _length);
+        close(_fd);
+        throw std::runtime_error(std::string("Not a puzzle bank: ") + path);
+    }
+    madvise(data, _length, MADV_RANDOM);
+}
+
+PuzzleBank::~PuzzleBank() {
+    munmap(const_cast<uint8_t*>(_data), _length);
+    close(_fd);
+}
+
+PuzzleView PuzzleBank::at(size_t index) const {
+    if (index >= size()) throw std::out_of_range("Puzzle bank index out of range.");
+    int g = std::upper_bound(_firstIndex.begin(), _firstIndex.end(), index) - _firstIndex.begin() - 1;
+    return PuzzleView(_data + _groups[g].offset + (index - _firstIndex[g]) * _groups[g].recordBytes, &_groups[g]);
+}
+
+size_t PuzzleBank::count(int size, int difficulty, int numClues) const {
+    size_t total = 0;
+    for (int g = 0; g < numGroups(); g++)
+        if (_groups[g].size == size && _groups[g].difficulty == difficulty && (numClues < 0 || _groups[g].numClues == numClues))
+            total += _groups[g].count;
+    return total;
+}
+
+PuzzleView PuzzleBank::find(int size, int difficulty, size_t k, int numClues) const {
+    for (int g = 0; g < numGroups(); g++) {
+        const Group& group = _groups[g];
+        if (group.size != size || group.difficulty != difficulty || (numClues >= 0 && group.numClues != numClues)) continue;
+        if (k < group.count) return PuzzleView(_data + group.offset + k * group.recordBytes, &group);
+        k -= group.count;
+    }
+    throw std::out_of_range("Puzzle bank has fewer puzzles of this kind.");
+}
+
+/* ================ BANK WRITER ============== */
+
+void PuzzleBankWriter::add(const Sudoku& puzzle, const Sudoku& solution, int difficulty) {
+    if (!SudokuSolver::isSolution(puzzle, solution)) throw std::invalid_argument("Bank solution does not solve its puzzle.");
+    int size = puzzle.getSize(), numCells = size*size, bits = bitsPerCell(size);
+    std::vector<uint8_t>& records = _records[std::make_tuple(size, difficulty, puzzle.getNumClues())];
+    size_t start = records.size();
+    records.resize(start + recordBytes(size), 0);
+    uint8_t* record = records.data() + start;
+    for (int i = 0; i < numCells; i++) {
+        unsigned value = solution.valueAt(i) - 1, bit = i * bits;
+        record[bit >> 3] |= value << (bit & 7);
+        if ((bit & 7) + bits > 8) record[(bit >> 3) + 1] |= value >> (8 - (bit & 7));
+    }
+    uint8_t* clues = record + (numCells * bits + 7) / 8;
+    for (int i = 0; i < numCells; i++)
+        if (!puzzle.isDraftAt(i)) clues[i >> 3] |= 1 << (i & 7);
+    _numPuzzles++;
+}
+
+void PuzzleBankWriter::add(const Sudoku& puzzle, int difficulty) {
+    Sudoku solution(puzzle);
+    if (!SudokuSolver::solve(solution)) throw std::invalid_argument("Bank puzzle has no solution.");
+    add(puzzle, solution, difficulty);
+}
+
+void PuzzleBankWriter::write(const char* path) const {
+    Header header = {};
+    std::memcpy(header.magic, bankMagic, 8);
+    header.version = bankVersion;
+    header.numGroups = _records.size();
+    header.numPuzzles = _numPuzzles;
+    header.groupsOffset = sizeof(Header);
+
+    std::vector<Group> groups;
+    uint64_t offset = sizeof(Header) + _records.size() * sizeof(Group);
+    for (auto& entry : _records) {
+        Group group = {};
+        group.size = std::get<0>(entry.first);
+        group.difficulty = std::get<1>(entry.first);
+        group.numClues = std::get<2>(entry.first);
+        group.bitsPerCell = bitsPerCell(group.size);
+        group.recordBytes = recordBytes(group.size);
+        group.count = entry.second.size() / group.recordBytes;
+        group.offset = offset;
+        offset += entry.second.size();
+        groups.push_back(group);
+    }
+
+    // written next to the target and renamed, so readers never map a half-written bank
+    std::string temporary = std::string(path) + ".tmp";
+    FILE* file = std::fopen(temporary.c_str(), "wb");
+    if (!file) throw std::runtime_error("Cannot write " + temporary);
+    bool ok = std::fwrite(&header, sizeof(Header), 1, file) == 1
+        && std::fwrite(groups.data(), sizeof(Group), groups.size(), file) == groups.size();
+    for (auto& entry : _records)
+        ok = ok && std::fwrite(entry.second.data(), 1, entry.second.size(), file) == entry.second.size();
+    ok = (std::fclose(file) == 0) && ok;
+    if (!ok || std::rename(temporary.c_str(), path) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error(std::string("Cannot write ") + path);
+    }
+}
+
+/* ================ COMMAND ================== */
+
+static int bankUsage() {
+    std::cerr << "usage: sudoku --bank write <file> [--size=N] [--count=N] [--seed=N]\n"
+                 "       sudoku --bank info <file>\n";
+    return 2;
+}
+
+int runBank(int argc, char* argv[]) {
+    if (argc < 2) return bankUsage();
+    std::string command = argv[0];
+    const char* path = argv[1];
+    int size = 9, count = 1000;
+    uint64_t seed = Random::freshSeed();
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.rfind("--size=", 0) == 0) size = std::atoi(arg.c_str() + 7);
+        else if (arg.rfind("--count=", 0) == 0) count = std::max(1, std::atoi(arg.c_str() + 8));
+        else if (arg.rfind("--seed=", 0) == 0) seed = std::strtoull(arg.c_str() + 7, nullptr, 10);
+        else return bankUsage();
+    }
+
+    try {
+        if (command == "write") {
+            std::chrono::steady_clock sc;
+            auto start = sc.now();
+            PuzzleBankWriter writer;
+            for (int difficulty = 1; difficulty < 5; difficulty++)
+                for (int k = 0; k < count; k++) {
+                    Random random(seed++);
+                    writer.add(Sudoku(difficulty, size, random), difficulty);
+                }
+            writer.write(path);
+            double seconds = static_cast<std::chrono::duration<double>>(sc.now() - start).count();
+            std::cerr << writer.size() << " puzzles written to " << path << " in " << seconds << " s\n";
+        }
+        else if (command == "info") {
+            PuzzleBank bank(path);
+            std::cout << bank.size() << " puzzles in " << bank.numGroups() << " groups\n";
+            for (int g = 0; g < bank.numGroups(); g++) {
+                const Group& group = bank.group(g);
+                std::cout << group.size << "x" << group.size << " difficulty " << int(group.difficulty) << ", "
+                          << group.numClues << " clues: " << group.count << " puzzles\n";
+            }
+        }
+        else return bankUsage();
+    }
+    catch (const std::exception& e) {
+        std::cerr << "sudoku: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
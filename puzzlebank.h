@@ -0,0 +1,143 @@
+#ifndef PUZZLEBANK_H
+#define PUZZLEBANK_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "sudoku.h"
+
+/* =========================================== */
+/* ================ PUZZLE BANK ============== */
+/* =========================================== */
+
+/* Binary file of puzzles with their solutions, read through mmap without any parsing.
+
+   Header (64 bytes): magic "SUDOKUB1", uint32 version, uint32 number of groups, uint64 number of puzzles,
+   uint64 offset of the group table. Then one 32-byte entry per group, sorted by size, difficulty and
+   clue count, each pointing at the records of its puzzles. A record is the solution with value-1 packed
+   in bitsPerCell bits per cell (2 for 4x4, 4 for 9x9 and 16x16, 5 for 25x25, 6 above), lowest bits first,
+   followed by the clue bitmap: 52 bytes for a 9x9 puzzle. Records are the same on every host, but the header
+   and group integers are written in host byte order: a bank from a host of the other order fails the version
+   check and is rejected */
+
+namespace PuzzleBankFormat {
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t numGroups;
+        uint64_t numPuzzles;
+        uint64_t groupsOffset;
+        uint8_t reserved[32];
+    };
+
+    struct Group {
+        uint16_t size;
+        uint8_t difficulty;
+        uint8_t bitsPerCell;
+        uint16_t numClues;
+        uint16_t reserved;
+        uint32_t recordBytes;
+        uint32_t reserved2;
+        uint64_t count;         // puzzles in the group
+        uint64_t offset;        // of the first record
+    };
+
+    static_assert(sizeof(Header) == 64 && sizeof(Group) == 32, "bank layout");
+
+    int bitsPerCell(int size);
+
+    uint32_t recordBytes(int size);
+}
+
+/* One puzzle of a mapped bank, decoded on access: valid as long as its bank */
+class PuzzleView {
+    const uint8_t* _record;
+    const PuzzleBankFormat::Group* _group;
+
+public:
+    PuzzleView(const uint8_t* record, const PuzzleBankFormat::Group* group) : _record(record), _group(group) {}
+
+    int getSize() const { return _group->size; }
+
+    int getDifficulty() const { return _group->difficulty; }
+
+    int getNumClues() const { return _group->numClues; }
+
+    int solutionAt(int i) const;
+
+    bool isClueAt(int i) const {
+        const uint8_t* clues = _record + _group->recordBytes - (getSize()*getSize() + 7) / 8;
+        return (clues[i >> 3] >> (i & 7)) & 1;
+    }
+
+    int valueAt(int i) const { return isClueAt(i) ? solutionAt(i) : 0; }
+
+    /* Puts the puzzle (or its solution) on a board of the same size, without allocating */
+    void load(Sudoku& board, bool solution = false) const;
+
+    /* New board holding the puzzle */
+    Sudoku puzzle() const;
+};
+
+/* Read-only mapping of a bank file. Throws std::runtime_error if the file cannot be read or is not a bank */
+class PuzzleBank {
+    int _fd;
+    const uint8_t* _data;
+    size_t _length;
+    const PuzzleBankFormat::Header* _header;
+    const PuzzleBankFormat::Group* _groups;
+    std::vector<uint64_t> _firstIndex;          // index of the first puzzle of each group
+
+public:
+    explicit PuzzleBank(const char* path);
+
+    ~PuzzleBank();
+
+    PuzzleBank(const PuzzleBank&) = delete;
+
+    PuzzleBank& operator=(const PuzzleBank&) = delete;
+
+    size_t size() const { return _header->numPuzzles; }
+
+    int numGroups() const { return _header->numGroups; }
+
+    const PuzzleBankFormat::Group& group(int g) const { return _groups[g]; }
+
+    /* Puzzle by its index in the whole bank, ordered like the groups */
+    PuzzleView at(size_t index) const;
+
+    /* Puzzles of a size and difficulty, with any number of clues, or numClues only */
+    size_t count(int size, int difficulty, int numClues = -1) const;
+
+    /* k-th of those puzzles, fewest clues first */
+    PuzzleView find(int size, int difficulty, size_t k, int numClues = -1) const;
+};
+
+/* Collects puzzles in memory, grouped as in the file, and writes them as a bank */
+class PuzzleBankWriter {
+    std::map<std::tuple<int, int, int>, std::vector<uint8_t>> _records; // by size, difficulty, clue count
+    size_t _numPuzzles;
+
+public:
+    PuzzleBankWriter() : _numPuzzles(0) {}
+
+    size_t size() const { return _numPuzzles; }
+
+    /* Adds a puzzle with its full solution. Throws std::invalid_argument if the solution does not solve it */
+    void add(const Sudoku& puzzle, const Sudoku& solution, int difficulty);
+
+    /* Adds a puzzle, solving it first */
+    void add(const Sudoku& puzzle, int difficulty);
+
+    /* Throws std::runtime_error if the file cannot be written */
+    void write(const char* path) const;
+};
+
+/* Entry point of "sudoku --bank write <file> [--size=N] [--count=N] [--seed=N]" (count puzzles of each
+   difficulty) and "sudoku --bank info <file>", returns the process exit code */
+int runBank(int argc, char* argv[]);
+
+#endif
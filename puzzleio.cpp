@@ -0,0 +1,200 @@
+#include "puzzleio.h"
+
+#include <stdexcept>
+#include <string>
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/* =========================================== */
+/* ============ PUZZLE LINE FORMAT =========== */
+/* =========================================== */
+
+static const int maxCharSize = 25; // largest board written one character per cell
+
+static int cellValue(char c) {
+    if (c == '.' || c == '0') return 0;
+    if (c >= '1' && c <= '9') return c - '0';
+    if (c >= 'A' && c <= 'Z') return c - 'A' + 10;
+    if (c >= 'a' && c <= 'z') return c - 'a' + 10;
+    return -1;
+}
+
+static char cellChar(int value) {
+    if (value == 0) return '.';
+    if (value < 10) return '0' + value;
+    return 'A' + value - 10;
+}
+
+/* Board size with numCells cells, 0 if there is none */
+static int sizeOf(int numCells) {
+    for (int boxSize = 2; boxSize*boxSize <= Sudoku::maxSize; boxSize++)
+        if (boxSize*boxSize*boxSize*boxSize == numCells) return boxSize*boxSize;
+    return 0;
+}
+
+int parsePuzzle(const char* line, size_t length, Sudoku::Value* values) {
+    while (length > 0 && (line[length-1] == ' ' || line[length-1] == '\t' || line[length-1] == '\r')) length--;
+
+    bool separated = false;
+    for (size_t i = 0; i < length && !separated; i++)
+        separated = line[i] == ',' || line[i] == ' ' || line[i] == '\t';
+
+    if (!separated) { // one character per cell
+        int size = sizeOf(length);
+        if (size == 0 || size > maxCharSize) return 0;
+        for (size_t i = 0; i < length; i++) {
+            int value = cellValue(line[i]);
+            if (value < 0 || value > size) return 0;
+            values[i] = value;
+        }
+        return size;
+    }
+
+    // numbers separated by commas or blanks
+    int numCells = 0, maxCells = Sudoku::maxSize * Sudoku::maxSize;
+    size_t i = 0;
+    while (i < length) {
+        if (line[i] == ',' || line[i] == ' ' || line[i] == '\t') { i++; continue; }
+        if (numCells == maxCells) return 0;
+        int value = 0;
+        if (line[i] == '.') i++;
+        else {
+            if (line[i] < '0' || line[i] > '9') return 0;
+            for (; i < length && line[i] >= '0' && line[i] <= '9'; i++) value = value*10 + (line[i] - '0');
+            if (value > Sudoku::maxSize) return 0;
+        }
+        if (i < length && line[i] != ',' && line[i] != ' ' && line[i] != '\t') return 0;
+        values[numCells++] = value;
+    }
+    int size = sizeOf(numCells);
+    for (int c = 0; c < numCells && size; c++)
+        if (values[c] > size) size = 0;
+    return size;
+}
+
+size_t formatPuzzle(const Sudoku& sudoku, char* out) {
+    int numCells = sudoku.getNumCells();
+    if (sudoku.getSize() <= maxCharSize) {
+        for (int i = 0; i < numCells; i++) out[i] = cellChar(sudoku.valueAt(i));
+        return numCells;
+    }
+    char* start = out;
+    for (int i = 0; i < numCells; i++) {
+        int value = sudoku.valueAt(i);
+        if (i > 0) *out++ = ',';
+        if (value >= 10) *out++ = '0' + value / 10;
+        *out++ = '0' + value % 10;
+    }
+    return out - start;
+}
+
+size_t maxLineLength(int size) {
+    return (size <= maxCharSize) ? size*size : 3*size*size;
+}
+
+/* =========================================== */
+/* =============== LINE READER =============== */
+/* =========================================== */
+
+LineReader::LineReader(const char* path) : _fd(0), _mapped(false), _data(nullptr), _begin(0), _end(0), _eof(false) {
+    if (path && std::string(path) != "-") {
+        _fd = open(path, O_RDONLY);
+        if (_fd < 0) throw std::runtime_error(std::string("Cannot open ") + path);
+
+        struct stat info;
+        if (fstat(_fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            void* data = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, _fd, 0);
+            if (data != MAP_FAILED) {
+                madvise(data, info.st_size, MADV_SEQUENTIAL);
+                _mapped = true;
+                _data = static_cast<const char*>(data);
+                _end = info.st_size;
+                _eof = true;
+                return;
+            }
+        }
+    }
+    _buffer.resize(1 << 20); // not a regular file (or mmap failed) -> read in blocks
+    _data = _buffer.data();
+}
+
+LineReader::~LineReader() {
+    if (_mapped) munmap(const_cast<char*>(_data), _end);
+    if (_fd > 0) close(_fd);
+}
+
+/* Moves the unread part to the front of the buffer and reads more, false if nothing was read */
+bool LineReader::fill() {
+    if (_eof) return false;
+    size_t unread = _end - _begin;
+    if (unread == _buffer.size()) _buffer.resize(2 * _buffer.size()); // line longer than the buffer
+    else std::memmove(_buffer.data(), _buffer.data() + _begin, unread);
+    _data = _buffer.data();
+    _begin = 0;
+    _end = unread;
+
+    ssize_t n;
+    do n = read(_fd, _buffer.data() + _end, _buffer.size() - _end);
+    while (n < 0 && errno == EINTR);
+    if (n <= 0) { _eof = true; return false; }
+    _end += n;
+    return true;
+}
+
+bool LineReader::next(const char*& line, size_t& length) {
+    while (true) {
+        const char* newline = static_cast<const char*>(std::memchr(_data + _begin, '\n', _end - _begin));
+        if (newline) {
+            line = _data + _begin;
+            length = newline - line;
+            _begin += length + 1;
+            break;
+        }
+        if (!fill()) { // last line without a newline
+            if (_begin == _end) return false;
+            line = _data + _begin;
+            length = _end - _begin;
+            _begin = _end;
+            break;
+        }
+    }
+    if (length > 0 && line[length-1] == '\r') length--;
+    return true;
+}
+
+/* =========================================== */
+/* ============= BUFFERED WRITER ============= */
+/* =========================================== */
+
+BufferedWriter::BufferedWriter(int fd, size_t capacity) : _fd(fd), _buffer(capacity), _used(0) {}
+
+BufferedWriter::~BufferedWriter() { flush(); }
+
+char* BufferedWriter::reserve(size_t n) {
+    if (_used + n > _buffer.size()) {
+        flush();
+        if (n > _buffer.size()) _buffer.resize(n);
+    }
+    return _buffer.data() + _used;
+}
+
+void BufferedWriter::write(const char* text, size_t length) {
+    std::memcpy(reserve(length), text, length);
+    _used += length;
+}
+
+void BufferedWriter::flush() {
+    size_t done = 0;
+    while (done < _used) {
+        ssize_t n = ::write(_fd, _buffer.data() + done, _used - done);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break; // output closed - nothing more can be written
+        }
+        done += n;
+    }
+    _used = 0;
+}
@@ -0,0 +1,83 @@
+#ifndef PUZZLEIO_H
+#define PUZZLEIO_H
+
+#include <cstddef>
+#include <vector>
+
+#include "sudoku.h"
+
+/* =========================================== */
+/* ============ PUZZLE LINE FORMAT =========== */
+/* =========================================== */
+
+/* One puzzle per line, cells in row-major order.
+   Boards up to 25x25 use one character per cell: '1'-'9', then 'A'-'P' for 10-25
+   (16x16 is 1-9A-G), and '.' or '0' for an empty cell.
+   Any size can also be written as numbers separated by commas or spaces, '0' or '.' for an empty cell */
+
+/* Reads a puzzle line into values, returns the board size or 0 if the line is not a puzzle */
+int parsePuzzle(const char* line, size_t length, Sudoku::Value* values);
+
+/* Writes the board as a puzzle line (without newline), returns the number of characters */
+size_t formatPuzzle(const Sudoku& sudoku, char* out);
+
+/* Longest line formatPuzzle can write for a board size */
+size_t maxLineLength(int size);
+
+/* Longest line formatPuzzle can write for the board of a puzzle line of this length: every cell of the line
+   takes at least one character, or two with separators, so the board is never much longer than its line */
+inline size_t maxSolutionLength(size_t lineLength) { return lineLength + lineLength / 2 + 2; }
+
+/* =========================================== */
+/* =============== LINE READER =============== */
+/* =========================================== */
+
+/* Reads lines from a memory-mapped file, or from stdin in large blocks */
+class LineReader {
+    int _fd;
+    bool _mapped;
+    const char* _data;          // mapped file, or the read buffer
+    size_t _begin, _end;        // unread part of _data
+    std::vector<char> _buffer;
+    bool _eof;
+
+public:
+    explicit LineReader(const char* path = nullptr); // nullptr or "-" reads stdin
+
+    ~LineReader();
+
+    /* Next line without its terminator, false at the end of the input */
+    bool next(const char*& line, size_t& length);
+
+private:
+    bool fill();
+};
+
+/* =========================================== */
+/* ============= BUFFERED WRITER ============= */
+/* =========================================== */
+
+/* Collects output in one large buffer and writes it to a file descriptor in big chunks */
+class BufferedWriter {
+    int _fd;
+    std::vector<char> _buffer;
+    size_t _used;
+
+public:
+    explicit BufferedWriter(int fd = 1, size_t capacity = 1 << 20);
+
+    ~BufferedWriter();
+
+    /* Room for n more characters: write into it, then commit what was used */
+    char* reserve(size_t n);
+
+    void commit(size_t n) { _used += n; }
+
+    void write(const char* text, size_t length);
+
+    void put(char c) { *reserve(1) = c; _used++; }
+
+    void flush();
+};
+
+#endif
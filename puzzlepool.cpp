@@ -0,0 +1,166 @@
+#include "puzzlepool.h"
+
+#include <chrono>
+#include <stdexcept>
+
+/* =========================================== */
+/* =============== PUZZLE POOL =============== */
+/* =========================================== */
+
+PuzzlePool::Queue::Queue(const Kind& kind, size_t capacity)
+    : kind(kind), ready(capacity), refilling(true), inProgress(0), hits(0), misses(0), generated(0), generateNanoseconds(0),
+      busySince(0), refillNanoseconds(0) {}
+
+static long nowNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+PuzzlePool::PuzzlePool(const std::vector<Kind>& kinds, size_t capacity, size_t lowWater, int numThreads, uint64_t seed)
+    : _capacity(std::max<size_t>(capacity, 1)), _lowWater(std::min(lowWater, _capacity)), _nextSeed(seed), _stop(false) {
+    for (const Kind& kind : kinds) {
+        int boxSize = (int) sqrt(kind.size);
+        if (boxSize * boxSize != kind.size || kind.size > Sudoku::maxSize) throw std::invalid_argument("Sudoku size must have an integer square root.");
+        if (kind.difficulty < 1 || kind.difficulty > 4) throw std::invalid_argument("Difficulty must be between 1 and 5.");
+        _queues.emplace_back(new Queue(kind, _capacity));
+    }
+    if (numThreads <= 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int t = 0; t < numThreads; t++) _threads.emplace_back(&PuzzlePool::run, this);
+}
+
+PuzzlePool::~PuzzlePool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (std::thread& thread : _threads) thread.join();
+
+    Ready ready;
+    for (auto& queue : _queues)
+        while (queue->ready.pop(ready)) delete ready.puzzle;
+}
+
+PuzzlePool::Queue& PuzzlePool::queueOf(int size, int difficulty) const {
+    for (auto& queue : _queues)
+        if (queue->kind.size == size && queue->kind.difficulty == difficulty) return *queue;
+    throw std::invalid_argument("Puzzle pool does not keep puzzles of this size and difficulty.");
+}
+
+/* Pops a ready puzzle and wakes a generator when the queue drops below the low-water mark */
+bool PuzzlePool::pop(Queue& queue, Ready& ready) {
+    bool hit = queue.ready.pop(ready);
+    (hit ? queue.hits : queue.misses)++;
+    if (queue.ready.size() < _lowWater && !queue.refilling.exchange(true)) {
+        std::lock_guard<std::mutex> lock(_mutex); // a generator is then either waiting or yet to look for work
+        _wake.notify_one();
+    }
+    return hit;
+}
+
+std::unique_ptr<Sudoku> PuzzlePool::tryTake(int size, int difficulty, uint64_t* seed) {
+    Ready ready;
+    if (!pop(queueOf(size, difficulty), ready)) return nullptr;
+    if (seed) *seed = ready.seed;
+    return std::unique_ptr<Sudoku>(ready.puzzle);
+}
+
+std::unique_ptr<Sudoku> PuzzlePool::take(int size, int difficulty, uint64_t* seed) {
+    Ready ready;
+    if (!pop(queueOf(size, difficulty), ready)) { // miss -> generate it here
+        ready.seed = _nextSeed++;
+        Random random(ready.seed);
+        ready.puzzle = generate(queueOf(size, difficulty), random);
+    }
+    if (seed) *seed = ready.seed;
+    return std::unique_ptr<Sudoku>(ready.puzzle);
+}
+
+PuzzlePool::Stats PuzzlePool::stats(int size, int difficulty) const {
+    Queue& queue = queueOf(size, difficulty);
+    Stats stats;
+    stats.depth = queue.ready.size();
+    stats.capacity = _capacity;
+    stats.hits = queue.hits;
+    stats.misses = queue.misses;
+    stats.generated = queue.generated;
+    stats.generateSeconds = stats.generated ? queue.generateNanoseconds * 1e-9 / stats.generated : 0;
+    {
+        std::lock_guard<std::mutex> lock(_mutex); // refill time so far, with the refill under way
+        long refill = queue.refillNanoseconds + (queue.inProgress > 0 ? nowNanoseconds() - queue.busySince : 0);
+        stats.refillRate = refill > 0 ? queue.generated * 1e9 / refill : 0;
+    }
+    std::lock_guard<std::mutex> lock(queue.statsMutex);
+    stats.generation = queue.generation;
+    return stats;
+}
+
+void PuzzlePool::waitFull() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    for (auto& queue : _queues) queue->refilling = true;
+    _wake.notify_all();
+    _filled.wait(lock, [&] {
+        for (auto& queue : _queues)
+            if (queue->ready.size() < _capacity) return false;
+        return true;
+    });
+}
+
+/* The refilling queue furthest from full, counting puzzles being generated for it.
+   Queues that are full again stop refilling. Called with _mutex held */
+PuzzlePool::Queue* PuzzlePool::claimWork() {
+    Queue* best = nullptr;
+    size_t bestFill = _capacity;
+    for (auto& queue : _queues) {
+        if (!queue->refilling) continue;
+        size_t fill = queue->ready.size() + queue->inProgress;
+        if (fill >= _capacity) {
+            if (queue->inProgress > 0) continue;
+            queue->refilling = false;
+            // pops that found it still refilling did not wake anyone: they may have taken it low again meanwhile
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (queue->ready.size() >= _lowWater) continue;
+            queue->refilling = true;
+            fill = queue->ready.size();
+        }
+        if (fill < bestFill) { best = queue.get(); bestFill = fill; }
+    }
+    if (best && best->inProgress++ == 0) best->busySince = nowNanoseconds();
+    return best;
+}
+
+/* New puzzle of the queue's kind, counted in its generation stats */
+Sudoku* PuzzlePool::generate(Queue& queue, Random& random) {
+    SudokuSolver::SolverStats generation;
+    Sudoku* puzzle = new Sudoku(queue.kind.difficulty, queue.kind.size, random, &generation);
+    std::lock_guard<std::mutex> lock(queue.statsMutex);
+    queue.generation += generation;
+    return puzzle;
+}
+
+/* Generator thread: sleeps until a pop starts a refill */
+void PuzzlePool::run() {
+    std::chrono::steady_clock sc;
+    while (true) {
+        Queue* queue = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            while (!_stop && !(queue = claimWork())) _wake.wait(lock);
+            if (_stop) {
+                if (queue) queue->inProgress--;
+                return;
+            }
+        }
+
+        Ready ready;
+        ready.seed = _nextSeed++;
+        Random random(ready.seed);
+        auto start = sc.now();
+        ready.puzzle = generate(*queue, random);
+        queue->generateNanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(sc.now() - start).count();
+        queue->generated++;
+        if (!queue->ready.push(ready)) delete ready.puzzle; // cannot happen while only claimed work is pushed
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (--queue->inProgress == 0) queue->refillNanoseconds += nowNanoseconds() - queue->busySince;
+        if (queue->ready.size() >= _capacity) _filled.notify_all();
+    }
+}
@@ -0,0 +1,171 @@
+#ifndef PUZZLEPOOL_H
+#define PUZZLEPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "sudoku.h"
+
+/* =========================================== */
+/* ============= BOUNDED RING QUEUE ========== */
+/* =========================================== */
+
+/* Lock-free queue of fixed capacity for any number of producers and consumers (D. Vyukov's bounded
+   MPMC queue). Every slot carries a sequence number telling whether it is ready to be written or read,
+   so push and pop are one compare-and-swap on their position when nothing else is in the way */
+template <class T>
+class RingQueue {
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> _slots;
+    size_t _mask;                               // capacity - 1, capacity is a power of two
+    alignas(64) std::atomic<size_t> _pushPos;
+    alignas(64) std::atomic<size_t> _popPos;
+
+public:
+    explicit RingQueue(size_t capacity) : _mask(1), _pushPos(0), _popPos(0) {
+        while (_mask + 1 < capacity) _mask = 2*_mask + 1;
+        _slots.reset(new Slot[_mask + 1]);
+        for (size_t i = 0; i <= _mask; i++) _slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    size_t capacity() const { return _mask + 1; }
+
+    /* Number of values, exact when nothing is pushing or popping */
+    size_t size() const {
+        size_t pushed = _pushPos.load(std::memory_order_relaxed), popped = _popPos.load(std::memory_order_relaxed);
+        return pushed > popped ? pushed - popped : 0;
+    }
+
+    /* False if the queue is full */
+    bool push(const T& value) {
+        size_t pos = _pushPos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = _slots[pos & _mask];
+            intptr_t diff = (intptr_t) slot.sequence.load(std::memory_order_acquire) - (intptr_t) pos;
+            if (diff == 0) {
+                if (_pushPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = value;
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) return false; // slot still holds the value pushed one lap ago
+            else pos = _pushPos.load(std::memory_order_relaxed);
+        }
+    }
+
+    /* False if the queue is empty */
+    bool pop(T& value) {
+        size_t pos = _popPos.load(std::memory_order_relaxed);
+        while (true) {
+            Slot& slot = _slots[pos & _mask];
+            intptr_t diff = (intptr_t) slot.sequence.load(std::memory_order_acquire) - (intptr_t) (pos + 1);
+            if (diff == 0) {
+                if (_popPos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = slot.value;
+                    slot.sequence.store(pos + _mask + 1, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (diff < 0) return false; // slot not written yet
+            else pos = _popPos.load(std::memory_order_relaxed);
+        }
+    }
+};
+
+/* =========================================== */
+/* =============== PUZZLE POOL =============== */
+/* =========================================== */
+
+/* Keeps puzzles of some (size, difficulty) kinds ready. Each kind has a bounded queue that background
+   generator threads fill up to its capacity whenever it drops below the low-water mark. Taking a puzzle
+   is a lock-free pop; when the queue is empty the puzzle is generated on the calling thread (a miss).
+   Every puzzle is generated from its own seed (see Random), handed out with the puzzle */
+class PuzzlePool {
+public:
+    struct Kind {
+        int size, difficulty;
+    };
+
+    struct Stats {
+        size_t depth, capacity;     // puzzles ready now, and at most
+        long hits, misses;          // takes that found a puzzle ready / found the queue empty
+        long generated;             // puzzles made by the generator threads
+        double generateSeconds;     // their average generation time
+        double refillRate;          // puzzles per second the generator threads made of this kind while refilling it
+        SudokuSolver::SolverStats generation; // of every puzzle of this kind generated so far, on any thread
+    };
+
+    /* A puzzle and the seed that replays it */
+    struct Ready {
+        Sudoku* puzzle;
+        uint64_t seed;
+    };
+
+private:
+    struct Queue {
+        Kind kind;
+        RingQueue<Ready> ready;
+        std::atomic<bool> refilling;    // below the low-water mark and not full again yet
+        std::atomic<int> inProgress;    // puzzles being generated for this queue
+        std::atomic<long> hits, misses, generated, generateNanoseconds;
+        long busySince, refillNanoseconds; // start of the refill under way, and time of them all (with _mutex held)
+        std::mutex statsMutex;
+        SudokuSolver::SolverStats generation;
+
+        Queue(const Kind& kind, size_t capacity);
+    };
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    size_t _capacity, _lowWater;
+    std::atomic<uint64_t> _nextSeed;
+    std::vector<std::thread> _threads;
+    mutable std::mutex _mutex;          // claims of work, and the refill times
+    std::condition_variable _wake;      // some queue needs refilling, or the pool is stopping
+    std::condition_variable _filled;    // a queue is full
+    std::atomic<bool> _stop;
+
+public:
+    /* capacity puzzles per kind, refilled below lowWater. 0 threads for one per core */
+    PuzzlePool(const std::vector<Kind>& kinds, size_t capacity = 64, size_t lowWater = 16, int numThreads = 1,
+               uint64_t seed = Random::freshSeed());
+
+    ~PuzzlePool();
+
+    PuzzlePool(const PuzzlePool&) = delete;
+
+    PuzzlePool& operator=(const PuzzlePool&) = delete;
+
+    /* A new puzzle of this kind, owned by the caller. seed, when given, receives its seed.
+       Throws std::invalid_argument if the pool does not keep this kind */
+    std::unique_ptr<Sudoku> take(int size, int difficulty, uint64_t* seed = nullptr);
+
+    /* Like take, but nullptr instead of generating when no puzzle is ready */
+    std::unique_ptr<Sudoku> tryTake(int size, int difficulty, uint64_t* seed = nullptr);
+
+    Stats stats(int size, int difficulty) const;
+
+    /* Refills every queue, also those above the low-water mark, and blocks until they are full: for warming up */
+    void waitFull();
+
+private:
+    Queue& queueOf(int size, int difficulty) const;
+
+    bool pop(Queue& queue, Ready& ready);
+
+    Queue* claimWork();
+
+    Sudoku* generate(Queue& queue, Random& random);
+
+    void run();
+};
+
+#endif
@@ -0,0 +1,113 @@
+#include "session.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+/* =========================================== */
+/* ============== BOARD SESSION ============== */
+/* =========================================== */
+
+BoardSession::BoardSession(const Sudoku& puzzle, int historyLength)
+    : _board(puzzle), _conflicts((puzzle.getNumCells() + 63) / 64), _numConflicts(0), _numFilled(0),
+      _history(std::max(1, historyLength)), _oldest(0), _numMoves(0), _numPlayed(0) {
+    for (int i = 0; i < _board.getNumCells(); i++) {
+        if (_board.valueAt(i) != 0) _numFilled++;
+        if (_board.conflictsAt(i)) {
+            _conflicts[i >> 6] |= uint64_t(1) << (i & 63);
+            _numConflicts++;
+        }
+    }
+}
+
+bool BoardSession::isConflicting(const Coords& coords) const {
+    int size = _board.getSize();
+    if (coords._x < 0 || coords._y < 0 || coords._x >= size || coords._y >= size)
+        throw std::invalid_argument("Call to isConflicting with invalid coords.");
+    return conflictBit(coords._y * size + coords._x);
+}
+
+/* Brings the conflict bit of a cell up to date, noting it in change if it flipped */
+void BoardSession::update(int i, Change& change) {
+    bool conflicting = _board.conflictsAt(i);
+    if (conflicting == conflictBit(i)) return;
+    _conflicts[i >> 6] ^= uint64_t(1) << (i & 63);
+    if (conflicting) {
+        _numConflicts++;
+        change.conflicting[change.numConflicting++] = i;
+    }
+    else {
+        _numConflicts--;
+        change.resolved[change.numResolved++] = i;
+    }
+}
+
+/* Writes the value and updates the conflicts. Besides the cell itself, only the other holders of the old
+   digit in a unit where it was twice, and of the new digit in a unit where it was once, can change:
+   units are only scanned for those, so a move that does not touch a duplicate reads no other cell */
+BoardSession::Change BoardSession::apply(int i, int value) {
+    Change change;
+    int previous = _board.valueAt(i);
+    if (previous == value || !_board.isDraftAt(i)) return change;
+
+    int size = _board.getSize(), boxSize = _board.getBoxSize(), x = i % size, y = i / size;
+    int box = (y / boxSize) * boxSize + x / boxSize;
+    int units[3] = {y, size + x, 2*size + box};
+    bool scan[3];
+    for (int u = 0; u < 3; u++)
+        scan[u] = (previous != 0 && _board.unitCount(units[u], previous) == 2) || (value != 0 && _board.unitCount(units[u], value) == 1);
+
+    _board.setValueAt(i, value);
+    _numFilled += (value != 0) - (previous != 0);
+    change.applied = true;
+    update(i, change);
+
+    for (int u = 0; u < 3; u++) {
+        if (!scan[u]) continue;
+        for (int k = 0; k < size; k++) {
+            int j = (u == 0) ? y*size + k
+                  : (u == 1) ? k*size + x
+                  : ((box / boxSize) * boxSize + k / boxSize) * size + (box % boxSize) * boxSize + k % boxSize;
+            int held = _board.valueAt(j);
+            if (j != i && held != 0 && (held == previous || held == value)) update(j, change);
+        }
+    }
+    change.complete = isComplete();
+    return change;
+}
+
+BoardSession::Change BoardSession::play(const Coords& coords, int value) {
+    int size = _board.getSize();
+    if (coords._x < 0 || coords._y < 0 || coords._x >= size || coords._y >= size)
+        throw std::invalid_argument("Call to play with invalid coords.");
+    if (value < 0 || value > size) throw std::invalid_argument("Call to play with invalid value.");
+
+    int i = coords._y * size + coords._x;
+    Move move = {uint16_t(i), uint8_t(_board.valueAt(i)), uint8_t(value)};
+    Change change = apply(i, value);
+    if (!change.applied) return change;
+
+    // the moves undone are gone, the oldest one goes when the ring is full
+    int capacity = _history.size();
+    _numMoves = _numPlayed;
+    if (_numMoves == capacity) {
+        _oldest = (_oldest + 1) % capacity;
+        _numMoves--;
+        _numPlayed--;
+    }
+    _history[(_oldest + _numMoves) % capacity] = move;
+    _numMoves++;
+    _numPlayed++;
+    return change;
+}
+
+BoardSession::Change BoardSession::undo() {
+    if (!canUndo()) return Change();
+    const Move& move = _history[(_oldest + --_numPlayed) % _history.size()];
+    return apply(move.cell, move.previous);
+}
+
+BoardSession::Change BoardSession::redo() {
+    if (!canRedo()) return Change();
+    const Move& move = _history[(_oldest + _numPlayed++) % _history.size()];
+    return apply(move.cell, move.value);
+}
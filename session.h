@@ -0,0 +1,85 @@
+#ifndef SESSION_H
+#define SESSION_H
+
+#include <cstdint>
+#include <vector>
+
+#include "sudoku.h"
+
+/* =========================================== */
+/* ============== BOARD SESSION ============== */
+/* =========================================== */
+
+/* A board being played: moves, undo and redo, each reporting exactly the cells that started or stopped
+   conflicting. A cell conflicts when its digit appears again in its row, column or box. A move reads no other
+   cell unless it creates or removes a duplicate, and then scans at most its three units.
+   The memory of a session is fixed when it is created: its board, one bit per cell and a move history
+   of historyLength moves, the oldest ones dropped when it is full. A session is used by one thread at a time */
+class BoardSession {
+public:
+    static const int maxChanged = 4; // most cells a move makes conflicting, and most it resolves
+
+    /* What a move, undo or redo did */
+    struct Change {
+        bool applied = false;           // false for a clue cell, an unchanged cell or nothing to undo/redo
+        int numConflicting = 0;         // cells that started conflicting
+        int numResolved = 0;            // cells that stopped conflicting
+        int conflicting[maxChanged];    // cell indices (y*size + x)
+        int resolved[maxChanged];
+        bool complete = false;          // every cell filled and none conflicting
+    };
+
+private:
+    struct Move {
+        uint16_t cell;
+        uint8_t previous;
+        uint8_t value;
+    };
+
+    Sudoku _board;
+    std::vector<uint64_t> _conflicts;   // one bit per cell
+    int _numConflicts;
+    int _numFilled;
+    std::vector<Move> _history;         // ring of the moves played, then the ones undone
+    int _oldest;                        // position of the oldest move in the ring
+    int _numMoves;                      // moves in the ring
+    int _numPlayed;                     // of those, the ones not undone
+
+public:
+    /* Starts from the puzzle, with any values it has in draft cells */
+    explicit BoardSession(const Sudoku& puzzle, int historyLength = 64);
+
+    const Sudoku& board() const { return _board; }
+
+    /* Puts a value (0 to clear) in a draft cell. Throws std::invalid_argument for invalid coords or value */
+    Change play(const Coords& coords, int value);
+
+    Change undo();
+
+    Change redo();
+
+    bool canUndo() const { return _numPlayed > 0; }
+
+    bool canRedo() const { return _numPlayed < _numMoves; }
+
+    /* Digits that fit in an empty cell without a conflict, kept up to date by the board */
+    Sudoku::Mask candidates(const Coords& coords) const { return _board.getCandidates(coords); }
+
+    bool isConflicting(const Coords& coords) const;
+
+    int getNumConflicts() const { return _numConflicts; }
+
+    int getNumFilled() const { return _numFilled; }
+
+    /* The board is a solution of its puzzle: the clues never change */
+    bool isComplete() const { return _numFilled == _board.getNumCells() && _numConflicts == 0; }
+
+private:
+    bool conflictBit(int i) const { return (_conflicts[i >> 6] >> (i & 63)) & 1; }
+
+    Change apply(int i, int value);
+
+    void update(int i, Change& change);
+};
+
+#endif
@@ -0,0 +1,533 @@
+#include "sudoku.h"
+#include "dlx.h"
+#include "fixedsize.h"
+#include "verify.h"
+
+/* =========================================== */
+/* ============== SUDOKU SOLVER ============== */
+/* =========================================== */
+
+/* Solves a sudoku puzzle from currCell on, depth draft cells below where it started */
+static bool solveFrom(Sudoku& puzzle, const Coords& currCell, SudokuSolver::SolverStats* stats, int depth) {
+    // Check if reached end of board -> all done
+    if (puzzle.outOfBounds(currCell)) return true;
+
+    // Skip clue cells
+    if (!puzzle.isDraftCell(currCell)) return solveFrom( puzzle, puzzle.getNextCell(currCell), stats, depth );
+    SUDOKU_STAT(if (stats) stats->maxDepth = std::max(stats->maxDepth, depth + 1));
+    
+    // Go through all digits allowed by the sudoku rules
+    puzzle.setCell(currCell, 0);
+    for (Sudoku::Mask candidates = puzzle.getCandidates(currCell); candidates; candidates &= candidates - 1) {
+        int val = lowestBit(candidates);
+        if (stats) {
+            stats->nodes++;
+            SUDOKU_STAT(stats->candidatesTried++);
+        }
+
+        // Try building board with this value on current cell
+        puzzle.setCell(currCell, val);
+        bool isValidBoard = solveFrom( puzzle, puzzle.getNextCell(currCell), stats, depth + 1 );
+
+        // Cannot build valid board with this value -> try next value
+        if (!isValidBoard) puzzle.setCell(currCell, 0);
+
+        // Valid board found -> all done
+        else return true;
+    }
+
+    // No possible value -> backtrack and reassign previous values
+    SUDOKU_STAT(if (stats) stats->backtracks++);
+    return false;
+}
+
+bool SudokuSolver::solveRecursive(Sudoku& puzzle, const Coords& currCell, SolverStats* stats) {
+    PhaseTimer timer(stats ? &stats->searchSeconds : nullptr);
+    if (stats) {
+        stats->searches++;
+        stats->nodes++;
+    }
+    return solveFrom(puzzle, currCell, stats, 0);
+}
+
+/* Dancing links matrix of this thread, kept between puzzles */
+static DlxSolver& dancingLinks(int size) {
+    thread_local DlxSolver solver(size);
+    return solver;
+}
+
+/* Solves a sudoku puzzle, discarding any draft values - returns false if it has no solution */
+bool SudokuSolver::solve(Sudoku& puzzle, const Options& options) {
+    for (int i = 0; i < puzzle.getNumCells(); i++) puzzle.setValueAt(i, 0);
+    return countSolutions(puzzle, 1, options) == 1;
+}
+
+SudokuSolver::Deductions& SudokuSolver::Deductions::operator+=(const Deductions& other) {
+    nakedSingles += other.nakedSingles;
+    hiddenSingles += other.hiddenSingles;
+    lockedCandidates += other.lockedCandidates;
+    guesses += other.guesses;
+    return *this;
+}
+
+SudokuSolver::SolverStats& SudokuSolver::SolverStats::operator+=(const SolverStats& other) {
+    searches += other.searches;
+    nodes += other.nodes;
+    backtracks += other.backtracks;
+    maxDepth = std::max(maxDepth, other.maxDepth);
+    candidatesTried += other.candidatesTried;
+    outOfBudget += other.outOfBudget;
+    uniquenessChecks += other.uniquenessChecks;
+    rejectedClears += other.rejectedClears;
+    searchSeconds += other.searchSeconds;
+    fillSeconds += other.fillSeconds;
+    clearSeconds += other.clearSeconds;
+    return *this;
+}
+
+/* ================= SEARCH ================== */
+
+namespace {
+
+/* Next candidate to try, according to the value order */
+int pickValue(Sudoku::Mask candidates, const SudokuSolver::Options& options) {
+    if (options.valueOrder == SudokuSolver::ValueOrder::descending) return 63 - __builtin_clzll(candidates);
+    if (options.valueOrder == SudokuSolver::ValueOrder::random) {
+        Random& random = options.random ? *options.random : Random::thread();
+        for (int skip = random.uniform(0, popCount(candidates) - 1); skip > 0; skip--) candidates &= candidates - 1;
+    }
+    return lowestBit(candidates);
+}
+
+typedef Sudoku::Mask Mask;
+
+/* A change to the board made by the search */
+struct Change {
+    int cell;
+    bool assigned;      // cell was filled, otherwise candidates were removed
+    Mask excluded;      // removed candidates before the change
+};
+
+/* A cell being branched on */
+struct Frame {
+    int cell;
+    Mask remaining;     // candidates not tried yet
+    size_t mark;        // trail size when the node was entered (before its deductions)
+    size_t branchMark;  // trail size before the current candidate was placed
+};
+
+/* Buffers of a search, kept per thread so that repeated searches on a board size do not allocate */
+struct Workspace {
+    int size = 0;
+    bool busy = false;          // taken by a search running on this thread
+    std::vector<int> units;     // cells of each unit: rows, then columns, then boxes
+    std::vector<Mask> excluded; // candidates removed from each cell by deductions
+    std::vector<Change> trail;
+    std::vector<Frame> stack;   // one frame per branching level, at most one per empty cell
+    std::vector<Sudoku::Value> solution; // first solution found
+
+    void prepare(int size, int boxSize);
+};
+
+void Workspace::prepare(int newSize, int boxSize) {
+    int numCells = newSize*newSize;
+    if (newSize != size) {
+        size = newSize;
+        units.resize(3 * numCells);
+        int* unit = units.data();
+        for (int y = 0; y < size; y++)
+            for (int x = 0; x < size; x++) *unit++ = y*size + x;
+        for (int x = 0; x < size; x++)
+            for (int y = 0; y < size; y++) *unit++ = y*size + x;
+        for (int box = 0; box < size; box++) {
+            int boxStart_x = (box % boxSize) * boxSize, boxStart_y = (box / boxSize) * boxSize;
+            for (int y = boxStart_y; y < boxStart_y + boxSize; y++)
+                for (int x = boxStart_x; x < boxStart_x + boxSize; x++) *unit++ = y*size + x;
+        }
+        excluded.resize(numCells);
+        trail.reserve(4 * numCells);
+        stack.resize(numCells + 1);
+        solution.resize(numCells);
+    }
+    std::fill(excluded.begin(), excluded.end(), 0);
+    trail.clear();
+}
+
+Workspace& threadWorkspace() {
+    thread_local Workspace workspace;
+    return workspace;
+}
+
+/* Backtracking search on a puzzle. Deductions fill cells and remove candidates,
+   every change goes on a trail so abandoning a branch undoes exactly what it did */
+class Search {
+    Sudoku& _puzzle;
+    const SudokuSolver::Options& _options;
+    int _size, _boxSize;
+    Workspace _ownWorkspace;    // only used when a search on this thread already holds the thread's one
+    Workspace& _work;
+    std::vector<int>& _units;
+    std::vector<Mask>& _excluded;
+    std::vector<Change>& _trail;
+    std::vector<Frame>& _stack;
+    SudokuSolver::Deductions _deductions;
+    SudokuSolver::SolverStats _stats;
+
+public:
+    Search(Sudoku& puzzle, const SudokuSolver::Options& options);
+
+    ~Search() {
+        _work.busy = false;
+        if (_options.deductions) *_options.deductions += _deductions;
+        if (_options.stats) *_options.stats += _stats;
+    }
+
+    uint64_t count(uint64_t limit, const SudokuSolver::SolutionVisitor* visit = nullptr);
+
+    bool cancelled() const { return _options.cancelled(); }
+
+    bool gaveUp() const { return _stats.outOfBudget > 0; }
+
+    void forbid(int cell, int value);
+
+    void restore() { undo(0); }
+
+    void writeFirstSolution() const;
+
+private:
+    Mask candidates(int i) const { return _puzzle.valueAt(i) ? 0 : _puzzle.candidatesAt(i) & ~_excluded[i]; }
+
+    bool assign(int i, int value);
+
+    void exclude(int i, Mask digits, bool& changed);
+
+    void undo(size_t mark);
+
+    int chooseCell(Mask& cellCandidates, int start) const;
+
+    bool propagate();
+
+    bool nakedSingles(bool& changed);
+
+    bool hiddenSingles(bool& changed);
+
+    void lockedCandidates(bool& changed);
+};
+
+Search::Search(Sudoku& puzzle, const SudokuSolver::Options& options)
+    : _puzzle(puzzle), _options(options), _size(puzzle.getSize()), _boxSize(puzzle.getBoxSize()),
+      _work(threadWorkspace().busy ? _ownWorkspace : threadWorkspace()),
+      _units(_work.units), _excluded(_work.excluded), _trail(_work.trail), _stack(_work.stack) {
+    _work.busy = true;
+    _work.prepare(_size, _boxSize);
+}
+
+/* Fills an empty cell, fails if the value is no longer a candidate */
+bool Search::assign(int i, int value) {
+    if (!(candidates(i) & (Mask(1) << value))) return false;
+    _puzzle.setValueAt(i, value);
+    _trail.push_back({i, true, 0});
+    return true;
+}
+
+/* Removes digits from the candidates of a cell */
+void Search::exclude(int i, Mask digits, bool& changed) {
+    Mask removed = digits & candidates(i);
+    if (!removed) return;
+    _trail.push_back({i, false, _excluded[i]});
+    _excluded[i] |= removed;
+    _deductions.lockedCandidates += popCount(removed);
+    changed = true;
+}
+
+/* Puts the first solution found back on the board */
+void Search::writeFirstSolution() const {
+    for (int i = 0; i < _puzzle.getNumCells(); i++) _puzzle.setValueAt(i, _work.solution[i]);
+}
+
+/* Removes a candidate before the search starts, undone by restore */
+void Search::forbid(int cell, int value) {
+    _trail.push_back({cell, false, _excluded[cell]});
+    _excluded[cell] |= Mask(1) << value;
+}
+
+/* Reverts every change made after the trail had mark entries */
+void Search::undo(size_t mark) {
+    while (_trail.size() > mark) {
+        const Change& change = _trail.back();
+        if (change.assigned) _puzzle.setValueAt(change.cell, 0);
+        else _excluded[change.cell] = change.excluded;
+        _trail.pop_back();
+    }
+}
+
+/* Picks the empty cell to branch on: the first one in raster order (cells before start are all filled)
+   or the one with the fewest candidates. Returns -1 if the board is full and stops at the first cell
+   without candidates */
+int Search::chooseCell(Mask& cellCandidates, int start) const {
+    int best = -1, bestCount = _size + 1;
+    if (_options.cellOrder != SudokuSolver::CellOrder::raster) start = 0;
+    for (int i = start; i < _puzzle.getNumCells(); i++) {
+        if (_puzzle.valueAt(i) != 0) continue;
+        Mask mask = candidates(i);
+        int count = popCount(mask);
+        if (count < bestCount) {
+            best = i; bestCount = count; cellCandidates = mask;
+            if (count <= 1 || _options.cellOrder == SudokuSolver::CellOrder::raster) break; // cannot do better
+        }
+    }
+    return best;
+}
+
+/* Applies the deduction rules until none of them changes the board, false on a contradiction */
+bool Search::propagate() {
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        if (!nakedSingles(changed)) return false;
+        if (changed) continue; // cheap rules first
+        if (!hiddenSingles(changed)) return false;
+        if (changed) continue;
+        if (_size > 9 || _options.lockedCandidates) lockedCandidates(changed);
+    }
+    return true;
+}
+
+/* A cell with a single candidate takes it */
+bool Search::nakedSingles(bool& changed) {
+    for (int i = 0; i < _puzzle.getNumCells(); i++) {
+        if (_puzzle.valueAt(i) != 0) continue;
+        Mask mask = candidates(i);
+        if (mask == 0) return false;
+        if (mask & (mask - 1)) continue;
+        if (!assign(i, lowestBit(mask))) return false;
+        _deductions.nakedSingles++;
+        changed = true;
+    }
+    return true;
+}
+
+/* A digit that fits in only one cell of a unit goes there */
+bool Search::hiddenSingles(bool& changed) {
+    for (int unit = 0; unit < 3*_size; unit++) {
+        const int* cells = &_units[unit * _size];
+        Mask placed = 0, once = 0, twice = 0;
+        for (int k = 0; k < _size; k++) {
+            int value = _puzzle.valueAt(cells[k]);
+            if (value) { placed |= Mask(1) << value; continue; }
+            Mask mask = candidates(cells[k]);
+            twice |= once & mask;
+            once |= mask;
+        }
+        if ((placed | once) != _puzzle.allDigits()) return false; // some digit fits nowhere
+        for (Mask single = once & ~twice; single; single &= single - 1) {
+            int value = lowestBit(single);
+            int k = 0;
+            while (!(candidates(cells[k]) & (Mask(1) << value))) {
+                if (++k == _size) return false; // taken away by another single of this unit
+            }
+            if (!assign(cells[k], value)) return false;
+            _deductions.hiddenSingles++;
+            changed = true;
+        }
+    }
+    return true;
+}
+
+/* Pointing pairs: a digit confined to one row (column) within a box leaves the rest of that row (column).
+   Box-line reduction: a digit confined to one box within a row (column) leaves the rest of that box */
+void Search::lockedCandidates(bool& changed) {
+    for (int box = 0; box < _size; box++) {
+        int boxStart_x = (box % _boxSize) * _boxSize, boxStart_y = (box / _boxSize) * _boxSize;
+        for (int line = 0; line < 2; line++) { // rows, then columns
+            Mask segment[Sudoku::maxSize], inBox = 0;
+            for (int k = 0; k < _boxSize; k++) {
+                segment[k] = 0;
+                for (int j = 0; j < _boxSize; j++) {
+                    int x = boxStart_x + (line ? k : j), y = boxStart_y + (line ? j : k);
+                    segment[k] |= candidates(y*_size + x);
+                }
+                inBox |= segment[k];
+            }
+            for (int k = 0; k < _boxSize; k++) {
+                Mask others = 0;
+                for (int j = 0; j < _boxSize; j++) if (j != k) others |= segment[j];
+
+                // rest of the line, outside this box
+                int lineIndex = line ? boxStart_x + k : boxStart_y + k;
+                const int* cells = &_units[(line * _size + lineIndex) * _size];
+                int boxStart = line ? boxStart_y : boxStart_x;
+                Mask outside = 0;
+                for (int j = 0; j < _size; j++)
+                    if (j < boxStart || j >= boxStart + _boxSize) outside |= candidates(cells[j]);
+
+                Mask pointing = segment[k] & ~others & outside;
+                if (pointing)
+                    for (int j = 0; j < _size; j++)
+                        if (j < boxStart || j >= boxStart + _boxSize) exclude(cells[j], pointing, changed);
+
+                Mask claiming = segment[k] & ~outside & others;
+                if (claiming)
+                    for (int j = 0; j < _boxSize; j++) {
+                        if (j == k) continue;
+                        for (int m = 0; m < _boxSize; m++) {
+                            int x = boxStart_x + (line ? j : m), y = boxStart_y + (line ? m : j);
+                            exclude(y*_size + x, claiming, changed);
+                        }
+                    }
+            }
+        }
+    }
+}
+
+/* Counts solutions up to limit, without recursion: branching levels live on a preallocated stack.
+   The board is restored unless the limit is reached or visit stops the search, in which case it holds
+   the last solution found */
+uint64_t Search::count(uint64_t limit, const SudokuSolver::SolutionVisitor* visit) {
+    uint64_t found = 0;
+    int depth = 0;
+    bool enter = true; // entering a new node, otherwise resuming the deepest frame
+    _stats.searches++;
+    while (true) {
+        if (cancelled()) return found;
+        if (enter) {
+            if (++_stats.nodes > _options.nodeBudget && _options.nodeBudget) {
+                _stats.outOfBudget++;
+                return found;
+            }
+            size_t mark = _trail.size();
+            Mask cellCandidates = 0;
+            int cell = -2; // contradiction
+            if (!_options.propagate || propagate()) cell = chooseCell(cellCandidates, depth ? _stack[depth - 1].cell : 0);
+
+            if (cell == -1) { // board full -> found a solution
+                if (++found == 1)
+                    for (int i = 0; i < _puzzle.getNumCells(); i++) _work.solution[i] = _puzzle.valueAt(i);
+                if (found >= limit || (visit && !(*visit)(_puzzle))) return found;
+                undo(mark);
+            }
+            else if (cell >= 0 && cellCandidates) {
+                if (cellCandidates & (cellCandidates - 1)) _deductions.guesses++;
+                _stack[depth++] = {cell, cellCandidates, mark, _trail.size()};
+                SUDOKU_STAT(_stats.maxDepth = std::max(_stats.maxDepth, depth));
+            }
+            else undo(mark); // dead end
+        }
+        if (depth == 0) return found;
+
+        // undo the last candidate tried here and move to the next one
+        Frame& frame = _stack[depth - 1];
+        undo(frame.branchMark);
+        if (!frame.remaining) { // no candidate left -> backtrack
+            SUDOKU_STAT(_stats.backtracks++);
+            undo(frame.mark);
+            depth--;
+            enter = false;
+            continue;
+        }
+        int value = pickValue(frame.remaining, _options);
+        frame.remaining &= ~(Mask(1) << value);
+        SUDOKU_STAT(_stats.candidatesTried++);
+        assign(frame.cell, value);
+        enter = true;
+    }
+}
+
+}
+
+/* True if the search options fit the compile-time sized engine of the board (see fixedsize.h) */
+static bool fixedSize(const Sudoku& puzzle, const SudokuSolver::Options& options) {
+    return options.cellOrder == SudokuSolver::CellOrder::mostConstrained && options.propagate
+        && FixedSize::supports(puzzle.getSize());
+}
+
+/* Returns the number of solutions, stopping once limit is reached */
+int SudokuSolver::countSolutions(Sudoku& puzzle, int limit, const Options& options) {
+    PhaseTimer timer(options.stats ? &options.stats->searchSeconds : nullptr);
+    if (options.engine == Engine::dancingLinks) return dancingLinks(puzzle.getSize()).countSolutions(puzzle, limit, options);
+    if (puzzle.hasConflicts()) return 0;
+    if (fixedSize(puzzle, options)) return FixedSize::countSolutions(puzzle, limit, options, &puzzle);
+    Search search(puzzle, options);
+    int found = search.count(limit);
+    if (search.gaveUp()) {
+        search.restore();
+        return gaveUp;
+    }
+    if ((found > 0 && limit > 1) || search.cancelled()) { // the board holds the last solution, or a partial one
+        search.restore();
+        if (found > 0) search.writeFirstSolution();
+    }
+    return found;
+}
+
+uint64_t SudokuSolver::forEachSolution(Sudoku& puzzle, const SolutionVisitor& visit, const Options& options) {
+    PhaseTimer timer(options.stats ? &options.stats->searchSeconds : nullptr);
+    if (puzzle.hasConflicts()) return 0;
+    if (fixedSize(puzzle, options)) {
+        long long found = FixedSize::forEachSolution(puzzle, visit ? &visit : nullptr, options);
+        if (found != FixedSize::unsupported) return found;
+    }
+    Search search(puzzle, options);
+    uint64_t found = search.count(UINT64_MAX, visit ? &visit : nullptr);
+    search.restore();
+    return found;
+}
+
+/* Returns true is sudoku has exactly one solution */
+bool SudokuSolver::isUnique(const Sudoku& puzzle, const Options& options) {
+    if (options.engine == Engine::dancingLinks) return dancingLinks(puzzle.getSize()).isUnique(puzzle, options);
+    Sudoku copy = Sudoku(puzzle); // preserve board - we do not want to solve it
+    return countSolutions(copy, 2, options) == 1;
+}
+
+/* The engines, on a board whose cell holds no draft value */
+static bool searchWithout(Sudoku& puzzle, int cell, int value, const SudokuSolver::Options& options) {
+    if (options.engine == SudokuSolver::Engine::dancingLinks) return dancingLinks(puzzle.getSize()).hasSolutionWithout(puzzle, cell, value, options);
+    if (puzzle.hasConflicts()) return false;
+    if (fixedSize(puzzle, options) && puzzle.isDraftAt(cell)) { // try every other value of the cell in turn
+        bool found = false;
+        for (Sudoku::Mask others = puzzle.candidatesAt(cell) & ~(Sudoku::Mask(1) << value); others && !found; others &= others - 1) {
+            puzzle.setValueAt(cell, lowestBit(others));
+            found = FixedSize::countSolutions(puzzle, 1, options, nullptr) != 0; // giving up counts as found
+        }
+        puzzle.setValueAt(cell, 0);
+        return found;
+    }
+    Search search(puzzle, options);
+    search.forbid(cell, value);
+    bool found = search.count(1) > 0 || search.gaveUp();
+    search.restore();
+    return found;
+}
+
+/* True if the puzzle has a solution where the cell at index cell does not hold value.
+   Searches on the board itself and leaves it as it was, a draft value of the cell included */
+bool SudokuSolver::hasSolutionWithout(Sudoku& puzzle, int cell, int value, const Options& options) {
+    PhaseTimer timer(options.stats ? &options.stats->searchSeconds : nullptr);
+    int draft = puzzle.isDraftAt(cell) ? puzzle.valueAt(cell) : 0;
+    if (draft) puzzle.setValueAt(cell, 0); // the cell is searched, whatever was drafted in it
+    bool found = searchWithout(puzzle, cell, value, options);
+    if (draft) puzzle.setValueAt(cell, draft);
+    return found;
+}
+
+/* Built on countSolutions: a first solution already found lowers the limit to one */
+bool SudokuSolver::hasMultipleSolutions(Sudoku& puzzle, bool& solutionFound, const Options& options) {
+    int limit = solutionFound ? 1 : 2;
+    int found = countSolutions(puzzle, limit, options);
+    if (found > 0) solutionFound = true;
+    return found >= limit;
+}
+
+/* Checks if a solved sudoku (solution) is the solution to a sudoku puzzle (puzzle) */
+bool SudokuSolver::isSolution(const Sudoku& puzzle, const Sudoku& solution) {
+    if (solution.getSize() != puzzle.getSize()) return false;
+    Sudoku::Value clues[Sudoku::maxSize * Sudoku::maxSize], values[Sudoku::maxSize * Sudoku::maxSize];
+    for (int i = 0; i < puzzle.getNumCells(); i++) {
+        clues[i] = puzzle.isDraftAt(i) ? 0 : puzzle.valueAt(i);
+        values[i] = solution.valueAt(i);
+    }
+    bool ok;
+    verifySolutions(puzzle.getSize(), clues, values, 1, &ok);
+    return ok;
+}
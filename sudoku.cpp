@@ -1,78 +1,99 @@
 #include "sudoku.h"
+#include "fixedsize.h"
 
 /* =========================================== */
 /* ================ AUXILIARY ================ */
 /* =========================================== */
 
-template <class T>
-void shuffle(std::vector<T>& vec) {
-    static std::mt19937 random{ static_cast<std::mt19937::result_type>(std::time(nullptr)) };
-    std::shuffle(vec.begin(), vec.end(), random);
+Random& Random::thread() {
+    thread_local Random random(freshSeed());
+    return random;
+}
+
+uint64_t Random::freshSeed() {
+    std::random_device device;
+    return (uint64_t(device()) << 32) ^ device();
 }
 
 int getRandom(int min, int max) {
-    static std::mt19937 random{ static_cast<std::mt19937::result_type>(std::time(nullptr)) };
-    std::uniform_int_distribution die{ min, max };
-    return die(random);
+    return Random::thread().uniform(min, max);
 }
 
 /* =========================================== */
-/* =============== CELL CLASS ================ */
+/* ============== SUDOKU CLASS =============== */
 /* =========================================== */
 
-Sudoku::Cell::Cell(int val) : _value(val), _type(Type::draft) {};
+/* ============== CONSTRUCTORS =============== */
+/* =========================================== */
 
-Sudoku::Cell::Cell(const Cell& cell) : _value(cell._value), _type(cell._type) {};
+/* Number of 64-bit words of each part of the board block */
+static int cellWords(int size) { return (size*size * sizeof(Sudoku::Value) + 7) / 8; }
+static int clueWords(int size) { return (size*size + 63) / 64; }
+static int maskWords(int size) { return 3*size; }
+static int countWords(int size) { return (3*size*(size+1) + 7) / 8; }
 
-std::ostream& operator<<(std::ostream& out, const Sudoku::Cell& cell) {
-    if (cell._value == 0) return out << '*';
-    return out << cell._value;
+int Sudoku::storageWords(int size) {
+    return cellWords(size) + clueWords(size) + maskWords(size) + countWords(size);
 }
 
-/* =========================================== */
-/* ============== SUDOKU CLASS =============== */
-/* =========================================== */
+/* Points each part of the board into _storage */
+void Sudoku::setPointers() {
+    uint64_t* part = _storage;
+    _cells = reinterpret_cast<Value*>(part);     part += cellWords(_size);
+    _clues = part;                               part += clueWords(_size);
+    _rowUsed = part;
+    _colUsed = _rowUsed + _size;
+    _boxUsed = _colUsed + _size;                 part += maskWords(_size);
+    _counts = reinterpret_cast<uint8_t*>(part);
+}
 
-/* ============== CONSTRUCTORS =============== */
-/* =========================================== */
+Sudoku::Sudoku(int difficulty, int size) : Sudoku(difficulty, size, Random::thread()) {}
 
-Sudoku::Sudoku(int difficulty, int size) : _size(size) {
-    int root = (int) sqrt(_size);
-    if (root * root != _size) throw std::invalid_argument("Sudoku size must have an integer square root.");
+Sudoku::Sudoku(int difficulty, int size, Random& random, SudokuSolver::SolverStats* stats, GridFill gridFill)
+    : _size(size), _boxSize((int) sqrt(size)), _numCells(size*size) {
+    if (_boxSize * _boxSize != _size) throw std::invalid_argument("Sudoku size must have an integer square root.");
+    if (_size > maxSize) throw std::invalid_argument("Sudoku size must be at most 49.");
     if (difficulty < 1 || difficulty > 4) throw std::invalid_argument("Difficulty must be between 1 and 5.");
 
-    /* Memory allocation */
-    _columns = new Cell**[_size];
-    for (int x=0; x < _size; x++) {
-        _columns[x] = new Cell*[_size];
-        for (int y=0; y < _size; y++)
-            _columns[x][y] = new Cell(0);
-    }
-    
-    /* Initialize random puzzle */
-    fillBoardRecursive(); // Fills the board with a random valid configuration
-    
-    makeClues(); // Mark the cells as clues to distinguish from future drafts while solving
+    /* Memory allocation - one block, filled in by generate */
+    _storage = new uint64_t[storageWords(_size)];
+    setPointers();
 
-    makePuzzle(difficulty); // Make the puzzle by clearing some of the cells
+    generate(difficulty, random, stats, gridFill);
 }
 
-Sudoku::Sudoku(const Sudoku& sudoku) : _size(sudoku._size) {
-    _columns = new Cell**[_size];
-    for (int x=0; x < _size; x++) {
-        _columns[x] = new Cell*[_size];
-        for (int y=0; y < _size; y++)
-            _columns[x][y] = new Cell(*sudoku._columns[x][y]);
+Sudoku::Sudoku(int size, const Value* values) : _size(size), _boxSize((int) sqrt(size)), _numCells(size*size) {
+    if (_boxSize * _boxSize != _size) throw std::invalid_argument("Sudoku size must have an integer square root.");
+    if (_size > maxSize) throw std::invalid_argument("Sudoku size must be at most 49.");
+
+    _storage = new uint64_t[storageWords(_size)]();
+    setPointers();
+    load(values);
+}
+
+Sudoku::Sudoku(const Sudoku& sudoku) : _size(sudoku._size), _boxSize(sudoku._boxSize), _numCells(sudoku._numCells) {
+    int words = storageWords(_size);
+    _storage = new uint64_t[words];
+    std::memcpy(_storage, sudoku._storage, words * sizeof(uint64_t));
+    setPointers();
+}
+
+Sudoku& Sudoku::operator=(const Sudoku& sudoku) {
+    if (this == &sudoku) return *this;
+    if (_size != sudoku._size) { // different layout -> reallocate
+        delete[] _storage;
+        _size = sudoku._size;
+        _boxSize = sudoku._boxSize;
+        _numCells = sudoku._numCells;
+        _storage = new uint64_t[storageWords(_size)];
+        setPointers();
     }
+    std::memcpy(_storage, sudoku._storage, storageWords(_size) * sizeof(uint64_t));
+    return *this;
 }
 
 Sudoku::~Sudoku() {
-    for (int x=0; x < _size; x++) {
-        for (int y=0; y < _size; y++)
-            delete _columns[x][y];
-        delete _columns[x];
-    }
-    delete _columns;
+    delete[] _storage;
 }
 
 /* =========== GETTERS AND SETTERS =========== */
@@ -82,36 +103,68 @@ int Sudoku::getSize() const { return _size; }
 
 int Sudoku::getNumClues() const {
     int numClues = 0;
-    Cell* cell;
-    for (int x=0; x < _size; x++) {
-        for (int y=0; y < _size; y++) {
-            cell = _columns[x][y];
-            if (cell->_type == Cell::Type::clue) numClues++;
-        }
-    }
+    for (int w=0; w < clueWords(_size); w++)
+        numClues += __builtin_popcountll(_clues[w]);
     return numClues;
 }
 
 int Sudoku::getCellValue (const Coords& coords) const {
     if (outOfBounds(coords)) throw std::invalid_argument("Call to getCellValue with invalid coords.");
-    return _columns[coords._x][coords._y]->_value;
+    return _cells[index(coords)];
 }
 
 void Sudoku::setCell(const Coords& coords, int value) {
     if (outOfBounds(coords)) throw std::invalid_argument("Call to setCell with invalid coords.");
-    Cell* cell = _columns[coords._x][coords._y];
-    if (cell->_type == Cell::Type::draft) // clue cells cannot be altered
-        cell->_value = value;
+    if (value < 0 || value > _size) throw std::invalid_argument("Call to setCell with invalid value.");
+    int i = index(coords);
+    if (!isClueIndex(i)) // clue cells cannot be altered
+        placeValue(i, value);
+}
+
+/* Writes a value and keeps the unit masks and counts in sync */
+void Sudoku::placeValue(int i, int value) {
+    int prevValue = _cells[i];
+    if (prevValue == value) return;
+
+    int x = i % _size, y = i / _size, box = boxIndex(x, y);
+    uint8_t* rowCounts = _counts + y * (_size+1);
+    uint8_t* colCounts = _counts + (_size + x) * (_size+1);
+    uint8_t* boxCounts = _counts + (2*_size + box) * (_size+1);
+
+    if (prevValue != 0) { // digit leaves its units - clear the mask bit when no copy is left
+        Mask bit = Mask(1) << prevValue;
+        if (--rowCounts[prevValue] == 0) _rowUsed[y] &= ~bit;
+        if (--colCounts[prevValue] == 0) _colUsed[x] &= ~bit;
+        if (--boxCounts[prevValue] == 0) _boxUsed[box] &= ~bit;
+    }
+    if (value != 0) {
+        Mask bit = Mask(1) << value;
+        rowCounts[value]++; _rowUsed[y] |= bit;
+        colCounts[value]++; _colUsed[x] |= bit;
+        boxCounts[value]++; _boxUsed[box] |= bit;
+    }
+    _cells[i] = value;
 }
 
 bool Sudoku::isDraftCell(const Coords& coords) const {
     if (outOfBounds(coords)) throw std::invalid_argument("Call to isDraftCell with invalid coords.");
-    return _columns[coords._x][coords._y]->_type == Cell::Type::draft;
+    return !isClueIndex(index(coords));
+}
+
+/* Replaces the board with a new puzzle of the same size: non-zero values become clues */
+void Sudoku::load(const Value* values) {
+    std::memset(_storage, 0, storageWords(_size) * sizeof(uint64_t));
+    for (int i = 0; i < _numCells; i++) {
+        if (values[i] > _size) throw std::invalid_argument("Call to load with invalid value.");
+        if (values[i] == 0) continue;
+        placeValue(i, values[i]);
+        setClueIndex(i, true);
+    }
 }
 
 void Sudoku::makeCellClue(const Coords& coords) {
     if (outOfBounds(coords)) throw std::invalid_argument("Call to makeCellClue with invalid coords.");
-    _columns[coords._x][coords._y]->_type = Cell::Type::clue;
+    setClueIndex(index(coords), true);
 }
 
 /* ============= GAME MECHANICS ============== */
@@ -128,57 +181,36 @@ bool Sudoku::outOfBounds(const Coords& coords) const {
 
 bool Sudoku::isValidValue(const Coords& coords, int value) const {
     if (outOfBounds(coords)) throw std::invalid_argument("Call to isValidValue with invalid coords.");
-    int x = coords._x, y = coords._y;
-    int boxSize = (int) sqrt(_size);
-
     if (value < 1 || value > _size) return false; // 0 is not valid
-    for (int i=0; i < _size; i++) {
-        // check row
-        if (_columns[i][y]->_value == value && i != x)
-            return false;
-
-        // check column
-        if (_columns[x][i]->_value == value && i != y)
-            return false;
-    }
-    // check box
-    int boxStart_x = (x/boxSize)*boxSize, boxStart_y = (y/boxSize)*boxSize; // start of corresponding box
-    for (int i_x = boxStart_x; i_x < boxSize; i_x++)
-        for (int i_y = boxStart_y; i_y < boxSize; i_y++)
-            if (_columns[i_x][i_y]->_value == value && !(i_x==x && i_y==y))
-                return false;
+    int x = coords._x, y = coords._y, box = boxIndex(x, y);
 
-    return true;
+    // cell does not hold this value -> any occurrence in its units is a conflict
+    if (_cells[index(coords)] != value)
+        return !((_rowUsed[y] | _colUsed[x] | _boxUsed[box]) & (Mask(1) << value));
+
+    // cell holds this value -> conflict only if the value appears elsewhere in its units
+    return _counts[y * (_size+1) + value] == 1
+        && _counts[(_size + x) * (_size+1) + value] == 1
+        && _counts[(2*_size + box) * (_size+1) + value] == 1;
 }
 
-std::vector<int> Sudoku::getAllValidValues(const Coords& coords) const {
-    if (outOfBounds(coords)) throw std::invalid_argument("Call to getAllValidValues with invalid coords.");
-    int x = coords._x, y = coords._y;
-    int boxSize = (int) sqrt(_size);
-
-    // initialize vector to allow all values (ex. 1-9)
-    std::vector<bool> values;
-    for (int i = 0; i <= _size; i++) values.push_back(true);
-    values[0] = false; // 0 is only here for padding
-
-    // search for invalid values
-    for (int i=0; i < _size; i++) {
-        // check row
-        values[_columns[i][y]->_value] = false; // mark invalid values with false
-        // check column
-        values[_columns[x][i]->_value] = false;
-    }
-    // check box
-    int boxStart_x = (x/boxSize)*boxSize, boxStart_y = (y/boxSize)*boxSize; // start of corresponding box
-    for (int i_x = boxStart_x; i_x < boxSize; i_x++)
-        for (int i_y = boxStart_y; i_y < boxSize; i_y++)
-            values[_columns[i_x][i_y]->_value] = false;
+/* True if some digit appears twice in a row, column or box */
+bool Sudoku::hasConflicts() const {
+    for (int i = 0; i < 3*_size*(_size+1); i++)
+        if (_counts[i] > 1) return true;
+    return false;
+}
 
-    // only leave values that were not found (0 is removed as well)
-    std::vector<int> validValues;
-    for (int i = 0; i <= _size; i++)
-        if (values[i] == true) validValues.push_back(i);
+/* Digits not present in the row, column or box of the cell */
+Sudoku::Mask Sudoku::getCandidates(const Coords& coords) const {
+    if (outOfBounds(coords)) throw std::invalid_argument("Call to getCandidates with invalid coords.");
+    return candidatesAt(index(coords));
+}
 
+std::vector<int> Sudoku::getAllValidValues(const Coords& coords) const {
+    std::vector<int> validValues;
+    for (Mask candidates = getCandidates(coords); candidates; candidates &= candidates - 1)
+        validValues.push_back(lowestBit(candidates));
     return validValues;
 }
 
@@ -186,55 +218,169 @@ std::vector<int> Sudoku::getAllValidValues(const Coords& coords) const {
 /* ============= RANDOMIZE BOARD ============= */
 /* =========================================== */
 
+/* ============= GENERATOR ARENA ============= */
+
+/* Buffers of the generator, one set per thread. They only grow, so once a thread has generated
+   a board of the largest size it uses, generating allocates nothing */
+namespace {
+struct FillLevel {
+    Sudoku::Value pool[Sudoku::maxSize];    // shuffled candidates of the cell, tried from the back
+    int left;                               // candidates not tried yet
+};
+
+struct GeneratorArena {
+    std::vector<FillLevel> levels;          // one per cell, in raster order
+    std::vector<int> order;                 // cells in the order makePuzzle tries to clear them
+    std::vector<Sudoku::Value> saved;       // grid kept by polishGrid in case its search gives up
+
+    void prepare(int numCells) {
+        if ((int) levels.size() < numCells) levels.resize(numCells);
+        if ((int) order.size() < numCells) order.resize(numCells);
+        if ((int) saved.size() < numCells) saved.resize(numCells);
+    }
+};
+
+GeneratorArena& generatorArena(int numCells) {
+    thread_local GeneratorArena arena;
+    arena.prepare(numCells);
+    return arena;
+}
+}
+
+void Sudoku::generate(int difficulty, Random& random, SudokuSolver::SolverStats* stats, GridFill gridFill) {
+    if (difficulty < 1 || difficulty > 4) throw std::invalid_argument("Difficulty must be between 1 and 5.");
+    fillGrid(random, stats, gridFill);
+
+    makePuzzle(difficulty, random, stats); // Make the puzzle by clearing some of the cells
+}
+
+void Sudoku::fillGrid(Random& random, SudokuSolver::SolverStats* stats, GridFill gridFill) {
+    std::memset(_storage, 0, storageWords(_size) * sizeof(uint64_t)); // all cells empty and draft, no digits used
+
+    /* Initialize random puzzle */
+    SudokuSolver::Options fill;
+    fill.valueOrder = SudokuSolver::ValueOrder::random;
+    fill.random = &random;
+    fill.stats = stats;
+    {
+        SudokuSolver::PhaseTimer timer(stats ? &stats->fillSeconds : nullptr);
+        if (gridFill == GridFill::automatic) gridFill = (_size <= 16) ? GridFill::search : GridFill::pattern;
+        if (gridFill == GridFill::search) { // Fills the board with a random valid configuration
+            if (FixedSize::countSolutions(*this, 1, fill, this) == FixedSize::unsupported)
+                fillBoard(random, stats); // no compile-time sized engine for this size
+        }
+        else { // same, from a pattern
+            fillPattern(random);
+            if (gridFill == GridFill::polishedPattern) polishGrid(random, stats);
+        }
+    }
+
+    makeClues(); // Mark the cells as clues to distinguish from future drafts while solving
+}
+
 /* =============== FILL BOARD ================ */
 
-/* Fill valid board randomly */
-bool Sudoku::fillBoardRecursive(const Coords& currCell) {
-    // Check if reached end of board -> all done
-    if (outOfBounds(currCell)) return true;
+/* Fill valid board randomly, cell by cell in raster order. Backtracking clears the previous cell
+   and tries its next candidate, so the board itself is the undo trail */
+bool Sudoku::fillBoard(Random& random, SudokuSolver::SolverStats* stats) {
+    FillLevel* levels = generatorArena(_numCells).levels.data();
+    int i = 0;
+    bool enter = true; // entering cell i, otherwise trying its next candidate
+
+    while (true) {
+        FillLevel& level = levels[i];
+        if (enter) { // find all valid values, in random order
+            level.left = 0;
+            for (Mask candidates = candidatesAt(i); candidates; candidates &= candidates - 1)
+                level.pool[level.left++] = lowestBit(candidates);
+            random.shuffle(level.pool, level.pool + level.left);
+            SUDOKU_STAT(if (stats) stats->maxDepth = std::max(stats->maxDepth, i + 1));
+        }
 
-    // Find all valid values
-    std::vector<int> valuePool = getAllValidValues(currCell);
-    shuffle(valuePool);
-    
-    while (!valuePool.empty()) {
-        setCell(currCell, valuePool.back());
+        // No possible value -> backtrack and reassign the previous cell
+        if (level.left == 0) {
+            SUDOKU_STAT(if (stats) stats->backtracks++);
+            if (i == 0) return false;
+            placeValue(--i, 0);
+            enter = false;
+            continue;
+        }
 
         // Try building board with this value on current cell
-        bool isValidBoard = fillBoardRecursive( getNextCell(currCell) );
-
-        // Cannot build valid board with this value -> undo and try next value
-        if (!isValidBoard) {
-            setCell(currCell, 0);
-            valuePool.pop_back();
+        placeValue(i, level.pool[--level.left]);
+        if (stats) {
+            stats->nodes++;
+            SUDOKU_STAT(stats->candidatesTried++);
         }
+        if (++i == _numCells) return true; // reached end of board -> all done
+        enter = true;
+    }
+}
 
-        // Valid board found -> all done
-        else return true;
+/* ============== PATTERN FILL =============== */
+
+/* Random order of the lines (rows or columns) that keeps the lines of each band (or stack) together */
+static void shuffleLines(int* lines, int boxSize, Random& random) {
+    int groups[Sudoku::maxSize];
+    for (int g = 0; g < boxSize; g++) groups[g] = g;
+    random.shuffle(groups, groups + boxSize);
+    for (int g = 0; g < boxSize; g++) {
+        int* group = lines + g * boxSize;
+        for (int k = 0; k < boxSize; k++) group[k] = groups[g] * boxSize + k;
+        random.shuffle(group, group + boxSize);
     }
-    // No possible value -> backtrack and reassign previous values
-    return false;
 }
 
-/* Marks filled cells as clues */
-void Sudoku::makeClues() {
-    Cell* cell;
-    for (int x=0; x < _size; x++) {
-        for (int y=0; y < _size; y++) {
-            cell = _columns[x][y];
-            if (cell->_value != 0) cell->_type = Cell::Type::clue;
+/* Fills the board with the base pattern, where row r is row 0 shifted by boxSize*(r % boxSize) + r / boxSize,
+   under random transforms that keep a grid valid: digits relabeled, rows within bands, bands,
+   columns within stacks, stacks, and transposition */
+void Sudoku::fillPattern(Random& random) {
+    int rows[maxSize], columns[maxSize];
+    Value labels[maxSize + 1];
+    shuffleLines(rows, _boxSize, random);
+    shuffleLines(columns, _boxSize, random);
+    for (int v = 0; v <= _size; v++) labels[v] = v;
+    random.shuffle(labels + 1, labels + _size + 1);
+    bool transpose = random.uniform(0, 1);
+
+    for (int y = 0; y < _size; y++) {
+        int r = rows[y], shift = _boxSize * (r % _boxSize) + r / _boxSize;
+        for (int x = 0; x < _size; x++) {
+            int i = transpose ? x * _size + y : y * _size + x;
+            placeValue(i, labels[(shift + columns[x]) % _size + 1]);
         }
     }
 }
 
+/* Empties one random band of a full grid and fills it again by randomized backtracking,
+   so the grid is not only a transform of the base pattern. Keeps the grid if the search runs out of its budget */
+void Sudoku::polishGrid(Random& random, SudokuSolver::SolverStats* stats) {
+    Value* saved = generatorArena(_numCells).saved.data();
+    std::memcpy(saved, _cells, _numCells * sizeof(Value));
+
+    int band = random.uniform(0, _boxSize - 1);
+    for (int i = band * _boxSize * _size; i < (band+1) * _boxSize * _size; i++) placeValue(i, 0);
+
+    SudokuSolver::Options polish;
+    polish.valueOrder = SudokuSolver::ValueOrder::random;
+    polish.random = &random;
+    polish.stats = stats;
+    polish.nodeBudget = 4 * _numCells;
+    if (SudokuSolver::countSolutions(*this, 1, polish) != 1) // gave up > back to the pattern grid
+        for (int i = 0; i < _numCells; i++) placeValue(i, saved[i]);
+}
+
+/* Marks filled cells as clues */
+void Sudoku::makeClues() {
+    for (int i=0; i < _numCells; i++)
+        if (_cells[i] != 0) setClueIndex(i, true);
+}
+
 /* ============ UNIQUENESS CHECK ============= */
 
 /* Returns true is sudoku has exactly one solution */
 bool Sudoku::isUnique() const {
-    Sudoku copy = Sudoku(*this); // preserve board - we do not want to solve it
-    bool hasSolution = false;
-    bool hasMultipleSolutions = SudokuSolver::hasMultipleSolutions(copy, Coords(0,0), hasSolution);
-    return hasSolution & !hasMultipleSolutions;
+    return SudokuSolver::isUnique(*this);
 }
 
 /* =============== MAKE PUZZLE =============== */
@@ -252,36 +398,44 @@ int Sudoku::calculateNumClues(int difficulty) const {
     else { return _size*_size * 3/5; } // just to test
 }
 
-/* Clears N cells in the board according to the difficulty */
-void Sudoku::makePuzzle(int difficulty) {
+/* Clears N cells in the board according to the difficulty.
+   The board starts as the full solution and stays uniquely solvable after every accepted clear */
+void Sudoku::makePuzzle(int difficulty, Random& random, SudokuSolver::SolverStats* stats) {
+    SudokuSolver::PhaseTimer timer(stats ? &stats->clearSeconds : nullptr);
+    SudokuSolver::Options options;
+    options.stats = stats;
     int numTotalCells = _size*_size;
     int toClear = numTotalCells - calculateNumClues(difficulty); // number of cells to clear
 
-    // shuffled vector of all cells
-    std::vector<Coords> allCells;
+    // shuffled order of all cells, column by column
+    int* order = generatorArena(numTotalCells).order.data();
+    int numLeft = 0;
     for (int x = 0; x < _size; x++)
-        for (int y = 0; y < _size; y++) allCells.push_back(Coords(x,y));
-    shuffle(allCells);
+        for (int y = 0; y < _size; y++) order[numLeft++] = y * _size + x;
+    random.shuffle(order, order + numLeft);
 
-    int x, y, prevValue;
-    while (toClear > 0 && !allCells.empty()) {
+    int i, prevValue;
+    while (toClear > 0 && numLeft > 0) {
         // choose random cell to clear
-        Coords curr = allCells.back();
-        x = curr._x;
-        y = curr._y;
-        allCells.pop_back();
+        i = order[--numLeft];
 
         // try clearing this cell
-        prevValue = _columns[x][y]->_value;
-
-        _columns[x][y]->_value = 0;
-        _columns[x][y]->_type = Cell::Type::draft;
-
-        // check if sudoku remains unique
-        if (isUnique()) toClear--;
+        prevValue = _cells[i];
+
+        placeValue(i, 0);
+        setClueIndex(i, false);
+
+        // every other cell still holds the solution, so the puzzle stays unique
+        // unless some solution puts another value in this cell
+        bool rejected = SudokuSolver::hasSolutionWithout(*this, i, prevValue, options);
+        SUDOKU_STAT(if (stats) {
+            stats->uniquenessChecks++;
+            stats->rejectedClears += rejected;
+        });
+        if (!rejected) toClear--;
         else { // cannot clear this cell > restore it
-            _columns[x][y]->_value = prevValue;
-            _columns[x][y]->_type = Cell::Type::clue;
+            placeValue(i, prevValue);
+            setClueIndex(i, true);
         }
     }
 }
@@ -300,15 +454,16 @@ std::string columnSeparator(int sudokuSize) {
 }
 
 std::ostream& operator<<(std::ostream& out, const Sudoku& sudoku) {
-    int boxSize = (int) sqrt(sudoku._size);
+    int boxSize = sudoku._boxSize;
     out << "\n\n";
     for (int y=0; y < sudoku._size; y++) {
         if (y % boxSize == 0) out << columnSeparator(sudoku._size); // horizontal edge of box
         for (int x=0; x < sudoku._size; x++) {
-            Sudoku::Cell* cell = sudoku._columns[x][y];
+            int value = sudoku._cells[y*sudoku._size + x];
             if (x % boxSize == 0) out << "| "; // vertical edge of box
-            if (sudoku._size >= 10 && cell->_value < 10) out << ' ' << *cell << ' ';
-            else out << *cell << ' ';
+            if (sudoku._size >= 10 && value < 10) out << ' ';
+            if (value == 0) out << '*' << ' ';
+            else out << value << ' ';
         }
         out << "|\n";
     }
@@ -316,93 +471,3 @@ std::ostream& operator<<(std::ostream& out, const Sudoku& sudoku) {
     out << "\n\n";
     return out;
 }
-    
-
-/* =========================================== */
-/* ============== SUDOKU SOLVER ============== */
-/* =========================================== */
-
-/* Solves a sudoku puzzle */
-bool SudokuSolver::solveRecursive(Sudoku& puzzle, const Coords& currCell) {
-    // Check if reached end of board -> all done
-    if (puzzle.outOfBounds(currCell)) return true;
-
-    // Skip clue cells
-    if (!puzzle.isDraftCell(currCell)) return solveRecursive( puzzle, puzzle.getNextCell(currCell) );
-    
-    // Go through all possible digits
-    int puzzleSize = puzzle.getSize();
-    for (int val = 1; val <= puzzleSize; val++) {
-        // Skip invalid values due to sudoku rules
-        if (!puzzle.isValidValue(currCell, val)) continue; 
-
-        // Try building board with this value on current cell
-        puzzle.setCell(currCell, val);
-        bool isValidBoard = solveRecursive( puzzle, puzzle.getNextCell(currCell) );
-
-        // Cannot build valid board with this value -> try next value
-        if (!isValidBoard) puzzle.setCell(currCell, 0);
-
-        // Valid board found -> all done
-        else return true;
-    }
-
-    // No possible value -> backtrack and reassign previous values
-    return false;
-}
-
-void SudokuSolver::solve(Sudoku& puzzle) { 
-    solveRecursive(puzzle, Coords(0,0));
-}
-
-/* Similar to solveRecursive, but looks for second solution */
-bool SudokuSolver::hasMultipleSolutions(Sudoku& puzzle, const Coords& currCell, bool& solutionFound) {
-    // Check if reached end of board -> found new solution
-    if (puzzle.outOfBounds(currCell)) {
-        if (!solutionFound) { solutionFound = true; return false; } // first solution found - keep searching
-        else return true; // sudoku is not unique - end function
-    }
-
-    // Skip clue cells
-    if (!puzzle.isDraftCell(currCell)) return hasMultipleSolutions( puzzle, puzzle.getNextCell(currCell), solutionFound );
-
-    // Go through all possible digits
-    int puzzleSize = puzzle.getSize();
-    for (int val = 1; val <= puzzleSize; val++) {
-        // Skip invalid values due to sudoku rules
-        if (!puzzle.isValidValue(currCell, val)) continue; 
-
-        // Try building board with this value on current cell
-        puzzle.setCell(currCell, val);
-        bool isValidBoard = hasMultipleSolutions( puzzle, puzzle.getNextCell(currCell), solutionFound );
-
-        // Could not find second solution with this value -> undo and try next value
-        if (!isValidBoard) puzzle.setCell(currCell, 0);
-
-        // Second solution found -> sudoku is not unique
-        else return true;
-    }
-    // Could not find second solution -> backtrack and reassign previous values
-    return false;
-}
-
-/* Checks if a solved sudoku (solution) is the solution to a sudoku puzzle (puzzle) */
-bool SudokuSolver::isSolution(const Sudoku& puzzle, const Sudoku& solution) {
-    Coords coords{0,0};
-    int cellVal;
-    int size = puzzle.getSize();
-    for (coords._x=0; coords._x < size; coords._x++) {
-        for (coords._y=0; coords._y < size; coords._y++) {
-            cellVal = solution.getCellValue(coords);
-
-            // check that it is the same puzzle (same fixed cells)
-            if (!puzzle.isDraftCell(coords) && puzzle.getCellValue(coords) != cellVal)
-                return false;
-
-            // check that there are no invalid values
-            if (!solution.isValidValue(coords, cellVal))
-                return false;
-        }
-    }
-    return true;
-}
@@ -3,20 +3,67 @@
 
 #include <iostream>
 #include <vector>
+#include <cstdint>
+#include <cstring>
 #include <algorithm>
 #include <ctime>
 #include <random>
+#include <cmath>
+#include <atomic>
+#include <chrono>
+#include <functional>
 
 #include "coords.h"
 
+/* Search counters beyond the node count, and the phase timers, are left out with -DSUDOKU_NO_STATS */
+#ifdef SUDOKU_NO_STATS
+#define SUDOKU_STAT(statement)
+#else
+#define SUDOKU_STAT(statement) statement
+#endif
+
 /* =========================================== */
 /* ================ AUXILIARY ================ */
 /* =========================================== */
 
-template <class T>
-void shuffle(std::vector<int>& vec);
+/* Source of randomness of the board generator. The same seed replays the same boards, so creating
+   each board from its own context makes every board reproducible from its seed. A context is not
+   shared between threads: each thread uses its own, or the one of Random::thread() */
+class Random {
+    std::mt19937_64 _engine;
+    uint64_t _seed;
+
+public:
+    explicit Random(uint64_t seed) : _engine(seed), _seed(seed) {}
+
+    uint64_t seed() const { return _seed; }
+
+    /* Uniform in min..max, both included */
+    int uniform(int min, int max) { return std::uniform_int_distribution<int>{ min, max }(_engine); }
+
+    uint64_t next() { return _engine(); }
+
+    template <class T>
+    void shuffle(std::vector<T>& vec) { std::shuffle(vec.begin(), vec.end(), _engine); }
+
+    template <class T>
+    void shuffle(T* first, T* last) { std::shuffle(first, last, _engine); } // same order as a vector of the same length
+
+    /* Context of the calling thread, seeded from std::random_device */
+    static Random& thread();
+
+    /* Seed drawn from std::random_device, different in every process and thread */
+    static uint64_t freshSeed();
+};
+
+int getRandom(int min, int max); // from the context of the calling thread
+
+/* Digit sets are bitmasks: bit v is set for digit v */
+inline int popCount(uint64_t mask) { return __builtin_popcountll(mask); }
+
+inline int lowestBit(uint64_t mask) { return __builtin_ctzll(mask); }
 
-int getRandom(int min, int max);
+namespace SudokuSolver { struct SolverStats; }
 
 /* =========================================== */
 /* ============== SUDOKU CLASS =============== */
@@ -25,38 +72,60 @@ int getRandom(int min, int max);
 class Sudoku {
 
 public:
-    /* ================ CELL ================= */
-
-    struct Cell {
-        enum Type {clue, draft};
-
-        int _value;
-        Type _type;
-
-        Cell(int val);
-        Cell(const Cell& cell);
-        friend std::ostream& operator<<(std::ostream& out, const Cell& cell);
+    typedef uint8_t Value; // cell value, 0 for an empty cell
+    typedef uint64_t Mask; // set of digits, bit v for digit v
+
+    static const int maxSize = 49; // digits 1..size must fit in a Mask, and the size must be a square
+
+    /* How generation fills the full grid it then clears cells of */
+    enum class GridFill {
+        automatic,      // search up to 16x16, pattern for larger boards
+        search,         // randomized backtracking: any valid grid, but can stall on large boards without such an engine
+        pattern,        // base pattern shuffled by transforms that keep it valid, O(size^2) for any size
+        polishedPattern // pattern, then one band filled again by randomized backtracking - less regular, so
+                        // clearing it into a puzzle can be faster, but filling takes milliseconds on large boards
     };
 
-    /* ======================================= */
-
 private:
-    Cell*** _columns;
+    /* Board is one contiguous block (a copy is a single memcpy):
+       cell values (row-major), clue bitmap, used digits and digit counts per unit */
     int _size;
+    int _boxSize;
+    int _numCells;
+    uint64_t* _storage;
+    Value* _cells;      // _numCells values, cell (x,y) at index y*_size + x
+    uint64_t* _clues;   // one bit per cell, set for clue cells
+    Mask* _rowUsed;     // digits present in each row
+    Mask* _colUsed;     // digits present in each column
+    Mask* _boxUsed;     // digits present in each box
+    uint8_t* _counts;   // occurrences of each digit per unit (rows, columns, boxes), _size+1 per unit
+
+    static int storageWords(int size);
+
+    void setPointers();
 
 public:
 
     /* ============== CONSTRUCTORS =============== */
 
-    Sudoku(int difficulty = 1, int size = 9);
+    Sudoku(int difficulty = 1, int size = 9); // random board from the context of the calling thread
+
+    Sudoku(int difficulty, int size, Random& random, SudokuSolver::SolverStats* stats = nullptr, // stats of the generation are added to stats
+           GridFill gridFill = GridFill::automatic);
+
+    Sudoku(int size, const Value* values); // given puzzle: non-zero values become clues
 
     Sudoku(const Sudoku& sudoku);
 
+    Sudoku& operator=(const Sudoku& sudoku);
+
     ~Sudoku();
 
     /* =========== GETTERS AND SETTERS =========== */
     
     int getSize() const;
+
+    int getBoxSize() const { return _boxSize; }
     
     int getNumClues() const;
 
@@ -66,7 +135,22 @@ public:
 
     bool isDraftCell(const Coords& coords) const;
 
+    void load(const Value* values);
+
 private:
+    int index(const Coords& coords) const { return coords._y * _size + coords._x; }
+
+    bool isClueIndex(int i) const { return (_clues[i >> 6] >> (i & 63)) & 1; }
+
+    void setClueIndex(int i, bool clue) {
+        if (clue) _clues[i >> 6] |= uint64_t(1) << (i & 63);
+        else _clues[i >> 6] &= ~(uint64_t(1) << (i & 63));
+    }
+
+    int boxIndex(int x, int y) const { return (y / _boxSize) * _boxSize + x / _boxSize; }
+
+    void placeValue(int i, int value);
+
     void makeCellClue(const Coords& coords);
 
     /* ============= GAME MECHANICS ============== */
@@ -78,18 +162,65 @@ public:
 
     bool isValidValue(const Coords& coords, int value) const;
 
+    bool hasConflicts() const;
+
+    Mask getCandidates(const Coords& coords) const;
+
     std::vector<int> getAllValidValues(const Coords& coords) const;
 
+    /* ============ ACCESS BY INDEX ============== */
+    /* Unchecked access by cell index (y*size + x) for the solvers' inner loops */
+
+    int getNumCells() const { return _numCells; }
+
+    Mask allDigits() const { return (~Mask(0) >> (63 - _size)) & ~Mask(1); } // bits 1..size
+
+    int valueAt(int i) const { return _cells[i]; }
+
+    bool isDraftAt(int i) const { return !isClueIndex(i); }
+
+    Mask candidatesAt(int i) const {
+        int x = i % _size, y = i / _size;
+        return allDigits() & ~(_rowUsed[y] | _colUsed[x] | _boxUsed[boxIndex(x, y)]);
+    }
+
+    void setValueAt(int i, int value) { if (!isClueIndex(i)) placeValue(i, value); }
+
+    /* Makes the cell a clue holding value, or an empty draft cell for 0 - for generators shaping a puzzle */
+    void setClueAt(int i, int value) { placeValue(i, value); setClueIndex(i, value != 0); }
+
+    /* Copies of a digit in a unit: rows are units 0..size-1, then columns, then boxes */
+    int unitCount(int unit, int value) const { return _counts[unit * (_size+1) + value]; }
+
+    /* True if the digit of the cell appears again in its row, column or box */
+    bool conflictsAt(int i) const {
+        int value = _cells[i], x = i % _size, y = i / _size;
+        return value != 0 && (unitCount(y, value) > 1 || unitCount(_size + x, value) > 1
+                              || unitCount(2*_size + boxIndex(x, y), value) > 1);
+    }
+
     /* ============= RANDOMIZE BOARD ============= */
 
+public:
+    /* Replaces the board with a new random puzzle of the same size, as the constructor makes it.
+       Reuses the board's storage and the generator buffers of the thread: no allocation once they are warm */
+    void generate(int difficulty, Random& random, SudokuSolver::SolverStats* stats = nullptr, GridFill gridFill = GridFill::automatic);
+
+    /* Replaces the board with a random full grid of the same size, every cell a clue: the first half of generate */
+    void fillGrid(Random& random, SudokuSolver::SolverStats* stats = nullptr, GridFill gridFill = GridFill::automatic);
+
 private:
-    bool fillBoardRecursive(const Coords& currCell = Coords(0,0));
+    bool fillBoard(Random& random, SudokuSolver::SolverStats* stats);
+
+    void fillPattern(Random& random);
+
+    void polishGrid(Random& random, SudokuSolver::SolverStats* stats);
     
     void makeClues();
 
     int calculateNumClues(int difficulty) const;
 
-    void makePuzzle(int difficulty);
+    void makePuzzle(int difficulty, Random& random, SudokuSolver::SolverStats* stats);
 
 public:
     bool isUnique() const;
@@ -107,11 +238,111 @@ public:
 /* =========================================== */
 
 namespace SudokuSolver {
-    bool solveRecursive(Sudoku& puzzle, const Coords& currCell = Coords{0,0});
+    /* Which empty cell to branch on next */
+    enum class CellOrder { raster, mostConstrained };
+
+    /* In which order to try the candidates of that cell */
+    enum class ValueOrder { ascending, descending, random };
+
+    /* Backtracking on the board, or exact cover with dancing links (see dlx.h) */
+    enum class Engine { backtracking, dancingLinks };
+
+    /* What the search did: cells filled by each deduction rule and cells branched on */
+    struct Deductions {
+        long nakedSingles = 0;      // cells filled because a single digit fits
+        long hiddenSingles = 0;     // cells filled because a digit fits nowhere else in a unit
+        long lockedCandidates = 0;  // candidates removed by pointing pairs and box-line reduction
+        long guesses = 0;           // cells branched on with more than one candidate
 
-    void solve(Sudoku& puzzle);
+        Deductions& operator+=(const Deductions& other);
+    };
+
+    /* What searches and generations did, and where their time went. Counting costs a few increments per node */
+    struct SolverStats {
+        long searches = 0;          // searches run (countSolutions, or one per candidate in hasSolutionWithout)
+        long nodes = 0;             // search nodes entered: each root, and each candidate placed on a branched cell
+        long backtracks = 0;        // branched cells left after their last candidate
+        int maxDepth = 0;           // deepest branching level
+        long candidatesTried = 0;   // candidates placed on branched cells
+        long outOfBudget = 0;       // searches stopped by the node budget
+        long uniquenessChecks = 0;  // made by the generator, one per cell it tries to clear
+        long rejectedClears = 0;    // of those, the ones that found a second solution, so the clue stayed
+        double searchSeconds = 0;   // in searches, also those made by the generator
+        double fillSeconds = 0;     // generating full boards
+        double clearSeconds = 0;    // clearing cells of full boards into puzzles
+
+        SolverStats& operator+=(const SolverStats& other);
+    };
+
+    /* Adds the time until it goes out of scope to a timer (nothing for nullptr) */
+    class PhaseTimer {
+        double* _seconds;
+        std::chrono::steady_clock::time_point _start;
+
+    public:
+        explicit PhaseTimer(double* seconds) : _seconds(seconds) {
+            SUDOKU_STAT(if (_seconds) _start = std::chrono::steady_clock::now());
+        }
+
+        ~PhaseTimer() {
+            SUDOKU_STAT(if (_seconds) *_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count());
+        }
+    };
 
-    bool hasMultipleSolutions(Sudoku& puzzle, const Coords& currCell, bool& solutionFound);
+    /* countSolutions result of a search that ran out of its node budget */
+    const int gaveUp = -1;
+
+    struct Options {
+        Engine engine = Engine::backtracking;
+        CellOrder cellOrder = CellOrder::mostConstrained;
+        ValueOrder valueOrder = ValueOrder::ascending;
+        bool propagate = true;              // apply deductions before and during the search
+        bool lockedCandidates = false;      // that deduction on boards up to 9x9 too, where it costs more than the
+                                            // guesses it saves: off by default (larger boards always apply it)
+        Deductions* deductions = nullptr;   // when set, counts are added to it
+        const std::atomic<bool>* cancel = nullptr; // when it becomes true the search stops early
+        const std::atomic<bool>* outerCancel = nullptr; // same, for a flag of the caller under one of its own
+        Random* random = nullptr;           // for ValueOrder::random, nullptr for the context of the thread
+        SolverStats* stats = nullptr;       // when set, counts and times are added to it
+        long nodeBudget = 0;                // nodes one search may enter before giving up, 0 for no limit
+
+        bool cancelled() const {
+            return (cancel && cancel->load(std::memory_order_relaxed)) || (outerCancel && outerCancel->load(std::memory_order_relaxed));
+        }
+    };                                      // (cell/value order and deductions only apply to backtracking)
+
+    bool solveRecursive(Sudoku& puzzle, const Coords& currCell = Coords{0,0}, SolverStats* stats = nullptr);
+
+    bool solve(Sudoku& puzzle, const Options& options = Options());
+
+    /* Number of solutions, stopping at limit (so 0, 1, ... or limit). Runs on an explicit stack.
+       The board is left holding the first solution found, or unchanged if there is none.
+       A cancelled search returns the solutions found so far; one out of node budget returns gaveUp
+       and leaves the board unchanged (solve and isUnique then return false) */
+    int countSolutions(Sudoku& puzzle, int limit, const Options& options = Options());
+
+    bool isUnique(const Sudoku& puzzle, const Options& options = Options());
+
+    /* Receives the board holding each solution found; returning false stops the search */
+    typedef std::function<bool(const Sudoku& solution)> SolutionVisitor;
+
+    /* Backtracks through every solution, whatever the engine of the options, and returns how many it visited
+       (the one that stopped it included); an empty visitor only counts them. Nothing is kept between solutions.
+       A cancelled search, or one out of node budget, returns those visited so far. The board is left unchanged.
+       See enumerate.h for large counts */
+    uint64_t forEachSolution(Sudoku& puzzle, const SolutionVisitor& visit, const Options& options = Options());
+
+    /* A search that gives up counts as having found one */
+    bool hasSolutionWithout(Sudoku& puzzle, int cell, int value, const Options& options = Options());
+
+    /* Looks for a second solution (a first one may already be known through solutionFound) */
+    bool hasMultipleSolutions(Sudoku& puzzle, bool& solutionFound, const Options& options = Options());
+
+    /* The search covers every empty cell, whatever the cell given */
+    [[deprecated("the cell is ignored, use hasMultipleSolutions(puzzle, solutionFound, options)")]]
+    inline bool hasMultipleSolutions(Sudoku& puzzle, const Coords&, bool& solutionFound, const Options& options = Options()) {
+        return hasMultipleSolutions(puzzle, solutionFound, options);
+    }
 
     bool isSolution(const Sudoku& puzzle, const Sudoku& solution);
 }
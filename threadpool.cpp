@@ -0,0 +1,80 @@
+#include "threadpool.h"
+
+/* =========================================== */
+/* =============== THREAD POOL =============== */
+/* =========================================== */
+
+static thread_local int workerIndex = -1;
+static thread_local const ThreadPool* workerPool = nullptr;
+
+ThreadPool::ThreadPool(int numThreads) : _queued(0), _pending(0), _nextQueue(0), _stop(false) {
+    if (numThreads <= 0) numThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 0; i < numThreads; i++) _queues.emplace_back(new Queue());
+    for (int i = 0; i < numThreads; i++) _threads.emplace_back(&ThreadPool::run, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wake.notify_all();
+    for (std::thread& thread : _threads) thread.join();
+}
+
+int ThreadPool::currentWorker() { return workerIndex; }
+
+void ThreadPool::submit(Task task) {
+    int queue = (workerPool == this) ? workerIndex : _nextQueue++ % _queues.size();
+    _pending++;
+    {
+        std::lock_guard<std::mutex> lock(_queues[queue]->mutex);
+        _queues[queue]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(_mutex); // pairs with the sleeping workers' check
+        _queued++;
+    }
+    _wake.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this] { return _pending == 0; });
+}
+
+/* Own queue first (newest task), then the other queues (oldest task) */
+bool ThreadPool::takeTask(int worker, Task& task) {
+    int numQueues = _queues.size();
+    for (int k = 0; k < numQueues; k++) {
+        Queue& queue = *_queues[(worker + k) % numQueues];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        if (k == 0) { task = std::move(queue.tasks.back()); queue.tasks.pop_back(); }
+        else { task = std::move(queue.tasks.front()); queue.tasks.pop_front(); }
+        _queued--;
+        return true;
+    }
+    return false;
+}
+
+void ThreadPool::run(int worker) {
+    workerIndex = worker;
+    workerPool = this;
+    Task task;
+    while (true) {
+        if (takeTask(worker, task)) {
+            task(worker);
+            task = nullptr;
+            if (--_pending == 0) {
+                std::lock_guard<std::mutex> lock(_mutex);
+                _idle.notify_all();
+            }
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(_mutex);
+        _wake.wait(lock, [this] { return _queued > 0 || _stop; });
+        if (_stop && _queued == 0) return;
+    }
+}
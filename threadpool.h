@@ -0,0 +1,61 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* =========================================== */
+/* =============== THREAD POOL =============== */
+/* =========================================== */
+
+/* Fixed set of workers, each with its own task queue. A worker takes its newest task first
+   and, when its queue is empty, steals the oldest task of another worker */
+class ThreadPool {
+public:
+    typedef std::function<void(int worker)> Task; // receives the index of the worker running it
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> _queues;
+    std::vector<std::thread> _threads;
+    std::mutex _mutex;
+    std::condition_variable _wake;      // tasks were queued, or the pool is stopping
+    std::condition_variable _idle;      // every submitted task is done
+    std::atomic<long> _queued;          // tasks waiting in the queues
+    std::atomic<long> _pending;         // tasks submitted and not finished
+    std::atomic<unsigned> _nextQueue;   // round robin for tasks submitted from outside the pool
+    bool _stop;
+
+public:
+    explicit ThreadPool(int numThreads = 0); // 0 for one worker per core
+
+    ~ThreadPool();
+
+    int size() const { return _threads.size(); }
+
+    /* Queues a task: on the calling worker's own queue, or spread over the workers */
+    void submit(Task task);
+
+    /* Blocks until every submitted task has finished */
+    void wait();
+
+    /* Index of the worker running the caller, -1 outside the pool */
+    static int currentWorker();
+
+private:
+    bool takeTask(int worker, Task& task);
+
+    void run(int worker);
+};
+
+#endif
@@ -0,0 +1,183 @@
+#include "verify.h"
+#include "fixedsize.h"
+
+#include <immintrin.h>
+#include <stdexcept>
+#include <string>
+
+/* =========================================== */
+/* ============ SOLUTION CHECKING ============ */
+/* =========================================== */
+
+typedef Sudoku::Value Value;
+
+/* One board of any size: digit v is bit v-1 */
+static bool verifyBoard(int size, const Value* puzzle, const Value* grid) {
+    int boxSize = (int) sqrt(size), numCells = size*size;
+    uint64_t all = (uint64_t(1) << size) - 1;
+    uint64_t rows[Sudoku::maxSize] = {0}, columns[Sudoku::maxSize] = {0}, boxes[Sudoku::maxSize] = {0};
+    for (int i = 0; i < numCells; i++) {
+        int value = grid[i], x = i % size, y = i / size;
+        if (value < 1 || value > size) return false;
+        if (puzzle && puzzle[i] && puzzle[i] != value) return false;
+        uint64_t bit = uint64_t(1) << (value - 1);
+        rows[y] |= bit;
+        columns[x] |= bit;
+        boxes[(y / boxSize) * boxSize + x / boxSize] |= bit;
+    }
+    for (int u = 0; u < size; u++) // size cells holding all size digits -> each digit exactly once
+        if (rows[u] != all || columns[u] != all || boxes[u] != all) return false;
+    return true;
+}
+
+/* ================ 9x9 KERNELS ============== */
+
+/* The kernels work on cells instead of boards: byte k of the vector of a cell is the cell of board k.
+   Digits 1-8 become one bit of a byte and 9 a separate flag, so a unit is valid when the OR of its
+   nine cells has all 8 bits and some cell is a 9. Values outside 1..9 set nothing and fail the unit */
+
+static const int numCells9 = 81;
+
+static inline int bitReverse4(int k) { return ((k & 1) << 3) | ((k & 2) << 1) | ((k & 4) >> 1) | ((k & 8) >> 3); }
+
+/* Transposes 16 bytes of 16 boards into 16 cell vectors. Four rounds of byte interleaving send row r,
+   column c to row reverse(c), column reverse(r), so the rows are loaded in bit-reversed order */
+__attribute__((target("ssse3")))
+static inline void transpose16(const Value* boards, __m128i* cells) {
+    __m128i a[16], b[16];
+    for (int k = 0; k < 16; k++) a[k] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(boards + bitReverse4(k) * numCells9));
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 8; i++) {
+            b[i] = _mm_unpacklo_epi8(a[2*i], a[2*i + 1]);
+            b[i + 8] = _mm_unpackhi_epi8(a[2*i], a[2*i + 1]);
+        }
+        std::copy(b, b + 16, a);
+    }
+    for (int j = 0; j < 16; j++) cells[bitReverse4(j)] = a[j];
+}
+
+/* Cell vectors of 16 boards: cells 0..79 by transposing, the last one byte by byte */
+__attribute__((target("ssse3")))
+static void loadCells16(const Value* boards, __m128i* cells) {
+    for (int chunk = 0; chunk < 5; chunk++) transpose16(boards + 16*chunk, cells + 16*chunk);
+    alignas(16) Value last[16];
+    for (int k = 0; k < 16; k++) last[k] = boards[k * numCells9 + 80];
+    cells[80] = _mm_load_si128(reinterpret_cast<const __m128i*>(last));
+}
+
+/* 16 boards, bit k of the result set if board k passed */
+__attribute__((target("ssse3")))
+static uint32_t verify16(const Value* puzzles, const Value* grids) {
+    const __m128i lowDigits = _mm_setr_epi8(0, 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i fifteen = _mm_set1_epi8(15), nine = _mm_set1_epi8(9), zero = _mm_setzero_si128(), ones = _mm_set1_epi8(-1);
+    __m128i value[numCells9], clue[numCells9], digits[numCells9], isNine[numCells9];
+    loadCells16(grids, value);
+    if (puzzles) loadCells16(puzzles, clue);
+
+    __m128i good = ones;
+    for (int i = 0; i < numCells9; i++) {
+        digits[i] = _mm_shuffle_epi8(lowDigits, _mm_min_epu8(value[i], fifteen));
+        isNine[i] = _mm_cmpeq_epi8(value[i], nine);
+        if (puzzles) good = _mm_and_si128(good, _mm_or_si128(_mm_cmpeq_epi8(clue[i], zero), _mm_cmpeq_epi8(clue[i], value[i])));
+    }
+    for (int unit = 0; unit < 27; unit++) {
+        const uint16_t* cells = FixedSize::tables<3>.units[unit];
+        __m128i seen = zero, anyNine = zero;
+        for (int k = 0; k < 9; k++) {
+            seen = _mm_or_si128(seen, digits[cells[k]]);
+            anyNine = _mm_or_si128(anyNine, isNine[cells[k]]);
+        }
+        good = _mm_and_si128(good, _mm_and_si128(_mm_cmpeq_epi8(seen, ones), anyNine));
+    }
+    return _mm_movemask_epi8(good) & 0xFFFF;
+}
+
+/* Cell vectors of 32 boards, each one two 16-board halves */
+__attribute__((target("avx2")))
+static void loadCells32(const Value* boards, __m256i* cells) {
+    __m128i low[numCells9], high[numCells9];
+    loadCells16(boards, low);
+    loadCells16(boards + 16 * numCells9, high);
+    for (int i = 0; i < numCells9; i++) cells[i] = _mm256_set_m128i(high[i], low[i]);
+}
+
+/* 32 boards, bit k of the result set if board k passed */
+__attribute__((target("avx2")))
+static uint32_t verify32(const Value* puzzles, const Value* grids) {
+    const __m256i lowDigits = _mm256_setr_epi8(0, 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0,
+                                               0, 1, 2, 4, 8, 16, 32, 64, -128, 0, 0, 0, 0, 0, 0, 0);
+    const __m256i fifteen = _mm256_set1_epi8(15), nine = _mm256_set1_epi8(9), zero = _mm256_setzero_si256(), ones = _mm256_set1_epi8(-1);
+    __m256i value[numCells9], clue[numCells9], digits[numCells9], isNine[numCells9];
+    loadCells32(grids, value);
+    if (puzzles) loadCells32(puzzles, clue);
+
+    __m256i good = ones;
+    for (int i = 0; i < numCells9; i++) {
+        digits[i] = _mm256_shuffle_epi8(lowDigits, _mm256_min_epu8(value[i], fifteen));
+        isNine[i] = _mm256_cmpeq_epi8(value[i], nine);
+        if (puzzles) good = _mm256_and_si256(good, _mm256_or_si256(_mm256_cmpeq_epi8(clue[i], zero), _mm256_cmpeq_epi8(clue[i], value[i])));
+    }
+    for (int unit = 0; unit < 27; unit++) {
+        const uint16_t* cells = FixedSize::tables<3>.units[unit];
+        __m256i seen = zero, anyNine = zero;
+        for (int k = 0; k < 9; k++) {
+            seen = _mm256_or_si256(seen, digits[cells[k]]);
+            anyNine = _mm256_or_si256(anyNine, isNine[cells[k]]);
+        }
+        good = _mm256_and_si256(good, _mm256_and_si256(_mm256_cmpeq_epi8(seen, ones), anyNine));
+    }
+    return _mm256_movemask_epi8(good);
+}
+
+/* ================= DISPATCH ================ */
+
+enum class Kernel { scalar, ssse3, avx2 };
+
+static bool supported(Kernel kernel) {
+    __builtin_cpu_init();
+    return kernel == Kernel::scalar || (kernel == Kernel::avx2 ? __builtin_cpu_supports("avx2") : __builtin_cpu_supports("ssse3"));
+}
+
+static Kernel bestKernel() {
+    static const Kernel kernel = supported(Kernel::avx2) ? Kernel::avx2 : supported(Kernel::ssse3) ? Kernel::ssse3 : Kernel::scalar;
+    return kernel;
+}
+
+const char* verifyKernel(int size) {
+    if (size != 9) return "scalar";
+    switch (bestKernel()) {
+        case Kernel::avx2: return "avx2";
+        case Kernel::ssse3: return "ssse3";
+        default: return "scalar";
+    }
+}
+
+static size_t verifyWith(Kernel kernel, int size, const Value* puzzles, const Value* grids, size_t count, bool* ok) {
+    size_t numCells = size*size, done = 0, failed = 0;
+    size_t width = (kernel == Kernel::avx2) ? 32 : (kernel == Kernel::ssse3) ? 16 : 1;
+
+    for (; kernel != Kernel::scalar && done + width <= count; done += width) {
+        const Value* puzzleBlock = puzzles ? puzzles + done * numCells : nullptr;
+        uint32_t passed = (kernel == Kernel::avx2) ? verify32(puzzleBlock, grids + done * numCells)
+                                                   : verify16(puzzleBlock, grids + done * numCells);
+        for (size_t k = 0; k < width; k++) ok[done + k] = (passed >> k) & 1;
+        failed += width - popCount(passed);
+    }
+    for (; done < count; done++) { // boards left over, or no kernel for this size
+        ok[done] = verifyBoard(size, puzzles ? puzzles + done * numCells : nullptr, grids + done * numCells);
+        failed += !ok[done];
+    }
+    return failed;
+}
+
+size_t verifySolutions(int size, const Value* puzzles, const Value* grids, size_t count, bool* ok) {
+    return verifyWith((size == 9) ? bestKernel() : Kernel::scalar, size, puzzles, grids, count, ok);
+}
+
+size_t verifySolutions(const char* kernelName, int size, const Value* puzzles, const Value* grids, size_t count, bool* ok) {
+    std::string name = kernelName;
+    Kernel kernel = (name == "avx2") ? Kernel::avx2 : (name == "ssse3") ? Kernel::ssse3 : Kernel::scalar;
+    if (name != "scalar" && (kernel == Kernel::scalar || size != 9)) throw std::invalid_argument("No such verification kernel for this size.");
+    if (!supported(kernel)) throw std::runtime_error("Verification kernel not supported by this processor.");
+    return verifyWith(kernel, size, puzzles, grids, count, ok);
+}
@@ -0,0 +1,27 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+#include <cstddef>
+
+#include "sudoku.h"
+
+/* =========================================== */
+/* ============ SOLUTION CHECKING ============ */
+/* =========================================== */
+
+/* Checks many solved boards at once. Boards are given as values (see Sudoku::load), numCells values each,
+   one board after the other. A board passes if every row, column and box holds each digit once and it
+   agrees with every clue (non-zero value) of its puzzle. 9x9 boards are checked 32 or 16 at a time
+   with AVX2 or SSSE3 when the processor has them, other sizes and the leftovers one by one */
+
+/* Sets ok[k] for each grid, puzzles may be nullptr to check the grids alone. Returns the number of failed grids */
+size_t verifySolutions(int size, const Sudoku::Value* puzzles, const Sudoku::Value* grids, size_t count, bool* ok);
+
+/* Same with the kernel named, "avx2", "ssse3" (9x9 only) or "scalar", to check the kernels against each other.
+   Throws std::invalid_argument for an unknown kernel, std::runtime_error if the processor lacks it */
+size_t verifySolutions(const char* kernel, int size, const Sudoku::Value* puzzles, const Sudoku::Value* grids, size_t count, bool* ok);
+
+/* Name of the kernel verifySolutions uses for a board size on this machine: "avx2", "ssse3" or "scalar" */
+const char* verifyKernel(int size);
+
+#endif